@@ -0,0 +1,247 @@
+#include "CommitGraph.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace
+{
+	constexpr uint32_t ChunkFanout = 0x4f494446; // OIDF
+	constexpr uint32_t ChunkOidLookup = 0x4f49444c; // OIDL
+	constexpr uint32_t ChunkCommitData = 0x43444154; // CDAT
+	constexpr uint32_t ChunkExtraEdges = 0x45444745; // EDGE
+
+	constexpr size_t HeaderSize = 8;
+	constexpr size_t ChunkEntrySize = 12;
+	constexpr size_t FanoutSize = 256 * 4;
+	constexpr size_t CommitDataSize = CommitGraph::OidSize + 16;
+
+	constexpr uint32_t ParentNone = 0x70000000;
+	constexpr uint32_t ParentExtraEdges = 0x80000000;
+	constexpr uint32_t LastEdge = 0x80000000;
+
+	uint32_t ReadUint32(const unsigned char* data)
+	{
+		return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16
+			| static_cast<uint32_t>(data[2]) << 8 | static_cast<uint32_t>(data[3]);
+	}
+
+	uint64_t ReadUint64(const unsigned char* data)
+	{
+		return static_cast<uint64_t>(ReadUint32(data)) << 32 | ReadUint32(data + 4);
+	}
+
+	bool ReadFile(const std::filesystem::path& file_path, std::vector<unsigned char>& data)
+	{
+		std::ifstream f{file_path, std::ios::binary};
+		if (!f.is_open())
+			return false;
+
+		data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		return !f.bad();
+	}
+}
+
+bool CommitGraph::Open(const std::filesystem::path& objects_dir)
+{
+	layers.clear();
+
+	std::error_code error;
+	const auto single_file = objects_dir / "info" / "commit-graph";
+	if (exists(single_file, error))
+		return LoadLayer(single_file);
+
+	const auto chain_dir = objects_dir / "info" / "commit-graphs";
+	std::ifstream chain{chain_dir / "commit-graph-chain"};
+	if (!chain.is_open())
+		return false;
+
+	// Chain lists the base layer first, positions are global across all layers
+	std::string hash;
+	while (std::getline(chain, hash))
+	{
+		if (hash.empty())
+			continue;
+
+		if (!LoadLayer(chain_dir / ("graph-" + hash + ".graph")))
+		{
+			layers.clear();
+			return false;
+		}
+	}
+
+	return !layers.empty();
+}
+
+bool CommitGraph::IsEmpty() const
+{
+	return layers.empty();
+}
+
+bool CommitGraph::Find(const unsigned char* oid, uint32_t& position) const
+{
+	for (const auto& layer : layers)
+	{
+		const unsigned char* fanout = layer.data.data() + layer.fanout;
+		const uint32_t first = oid[0] ? ReadUint32(fanout + (oid[0] - 1) * 4) : 0;
+		const uint32_t last = ReadUint32(fanout + oid[0] * 4);
+
+		uint32_t low = first, high = last;
+		while (low < high)
+		{
+			const uint32_t middle = low + (high - low) / 2;
+			const int cmp = memcmp(oid, layer.data.data() + layer.oids + static_cast<size_t>(middle) * OidSize, OidSize);
+			if (cmp == 0)
+			{
+				position = layer.base + middle;
+				return true;
+			}
+
+			if (cmp < 0)
+				high = middle;
+			else low = middle + 1;
+		}
+	}
+
+	return false;
+}
+
+const unsigned char* CommitGraph::GetOid(const uint32_t position) const
+{
+	uint32_t local_position;
+	const auto* layer = GetLayer(position, local_position);
+	if (!layer)
+		return nullptr;
+
+	return layer->data.data() + layer->oids + static_cast<size_t>(local_position) * OidSize;
+}
+
+int64_t CommitGraph::GetCommitTime(const uint32_t position) const
+{
+	uint32_t local_position;
+	const auto* layer = GetLayer(position, local_position);
+	if (!layer)
+		return 0;
+
+	// Lowest two bits of the generation word hold the 33rd and 34th bit of the time
+	const unsigned char* entry = layer->data.data() + layer->commit_data + static_cast<size_t>(local_position) * CommitDataSize;
+	const uint64_t generation_and_time = ReadUint64(entry + OidSize + 8);
+	return static_cast<int64_t>(generation_and_time & 0x3ffffffffull);
+}
+
+bool CommitGraph::GetParents(const uint32_t position, std::vector<uint32_t>& parents) const
+{
+	parents.clear();
+
+	uint32_t local_position;
+	const auto* layer = GetLayer(position, local_position);
+	if (!layer)
+		return false;
+
+	const unsigned char* entry = layer->data.data() + layer->commit_data + static_cast<size_t>(local_position) * CommitDataSize;
+
+	const uint32_t first_parent = ReadUint32(entry + OidSize);
+	if (first_parent == ParentNone)
+		return true;
+	parents.push_back(first_parent);
+
+	const uint32_t second_parent = ReadUint32(entry + OidSize + 4);
+	if (second_parent == ParentNone)
+		return true;
+
+	if (!(second_parent & ParentExtraEdges))
+	{
+		parents.push_back(second_parent);
+		return true;
+	}
+
+	// Octopus merges keep every parent after the first in the extra edges list
+	for (size_t offset = static_cast<size_t>(second_parent & ~ParentExtraEdges) * 4;
+		offset + 4 <= layer->extra_edges_size; offset += 4)
+	{
+		const uint32_t edge = ReadUint32(layer->data.data() + layer->extra_edges + offset);
+		parents.push_back(edge & ~LastEdge);
+		if (edge & LastEdge)
+			return true;
+	}
+
+	return false;
+}
+
+bool CommitGraph::LoadLayer(const std::filesystem::path& file_path)
+{
+	Layer layer;
+	if (!ReadFile(file_path, layer.data) || layer.data.size() < HeaderSize)
+		return false;
+
+	const unsigned char* data = layer.data.data();
+	if (memcmp(data, "CGPH", 4) != 0 || data[4] != 1 || data[5] != 1)
+		return false;
+
+	const size_t chunk_count = data[6];
+	if (layer.data.size() < HeaderSize + (chunk_count + 1) * ChunkEntrySize)
+		return false;
+
+	size_t oids_end = 0, commit_data_end = 0;
+	for (size_t i = 0; i < chunk_count; ++i)
+	{
+		const unsigned char* chunk_entry = data + HeaderSize + i * ChunkEntrySize;
+		const uint32_t chunk_id = ReadUint32(chunk_entry);
+		const uint64_t chunk_start = ReadUint64(chunk_entry + 4);
+		const uint64_t chunk_end = ReadUint64(chunk_entry + 4 + ChunkEntrySize);
+
+		if (chunk_start > chunk_end || chunk_end > layer.data.size())
+			return false;
+
+		switch (chunk_id)
+		{
+		case ChunkFanout:
+			if (chunk_end - chunk_start != FanoutSize)
+				return false;
+			layer.fanout = chunk_start;
+			break;
+		case ChunkOidLookup:
+			layer.oids = chunk_start;
+			oids_end = chunk_end;
+			break;
+		case ChunkCommitData:
+			layer.commit_data = chunk_start;
+			commit_data_end = chunk_end;
+			break;
+		case ChunkExtraEdges:
+			layer.extra_edges = chunk_start;
+			layer.extra_edges_size = chunk_end - chunk_start;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!layer.fanout || !layer.oids || !layer.commit_data)
+		return false;
+
+	layer.count = ReadUint32(data + layer.fanout + FanoutSize - 4);
+	if (oids_end - layer.oids < static_cast<size_t>(layer.count) * OidSize
+		|| commit_data_end - layer.commit_data < static_cast<size_t>(layer.count) * CommitDataSize)
+		return false;
+
+	if (!layers.empty())
+		layer.base = layers.back().base + layers.back().count;
+
+	layers.push_back(std::move(layer));
+	return true;
+}
+
+const CommitGraph::Layer* CommitGraph::GetLayer(const uint32_t position, uint32_t& local_position) const
+{
+	for (const auto& layer : layers)
+	{
+		if (position >= layer.base && position < layer.base + layer.count)
+		{
+			local_position = position - layer.base;
+			return &layer;
+		}
+	}
+
+	return nullptr;
+}
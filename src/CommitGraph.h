@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Read-only view of git's commit-graph file (single file or split chain, SHA-1 only).
+// libgit2 does not expose its own reader, so mgit parses the file to walk history
+// without inflating commit objects.
+class CommitGraph
+{
+public:
+	static constexpr size_t OidSize = 20;
+
+	bool Open(const std::filesystem::path& objects_dir);
+	bool IsEmpty() const;
+
+	bool Find(const unsigned char* oid, uint32_t& position) const;
+	const unsigned char* GetOid(uint32_t position) const;
+	int64_t GetCommitTime(uint32_t position) const;
+	bool GetParents(uint32_t position, std::vector<uint32_t>& parents) const;
+
+private:
+	struct Layer
+	{
+		std::vector<unsigned char> data;
+		size_t fanout = 0;
+		size_t oids = 0;
+		size_t commit_data = 0;
+		size_t extra_edges = 0;
+		size_t extra_edges_size = 0;
+		uint32_t count = 0;
+		uint32_t base = 0;
+	};
+
+	std::vector<Layer> layers;
+
+	bool LoadLayer(const std::filesystem::path& file_path);
+	const Layer* GetLayer(uint32_t position, uint32_t& local_position) const;
+};
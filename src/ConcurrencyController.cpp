@@ -0,0 +1,167 @@
+#include "ConcurrencyController.h"
+
+#include <algorithm>
+
+#include "Config.h"
+#include "Tasks/Task.h"
+
+namespace
+{
+	// A sample this many times above its repository's history is taken as a sign of congestion
+	constexpr int64_t congestion_factor = 4;
+	// Differences below this are scheduling noise rather than congestion, it matters for short status scans
+	constexpr int64_t congestion_slack_ms = 250;
+	// Weight of a new latency in the running average
+	constexpr double average_weight = 1.0 / 8;
+	// Longer histories are printed with their middle elided
+	constexpr size_t reported_changes = 20;
+
+	bool IsCongested(const LatencySample& sample)
+	{
+		if (sample.measured_ms < 0 || sample.expected_ms < 0)
+			return false;
+
+		return sample.measured_ms > sample.expected_ms * congestion_factor && sample.measured_ms - sample.expected_ms > congestion_slack_ms;
+	}
+}
+
+ConcurrencyController::ConcurrencyController(std::string name) :
+	name(std::move(name))
+{
+}
+
+void ConcurrencyController::Configure(const ConcurrencyLimits& limits)
+{
+	std::lock_guard lock(mutex);
+	min_limit = static_cast<double>(limits.min);
+	max_limit = static_cast<double>(limits.max);
+	limit = static_cast<double>(limits.initial);
+	average_ms = 0;
+	completed = 0;
+	failed = 0;
+	report_start = Clock::now();
+	decreased_at = report_start;
+	history = { { 0, GetWindow() } };
+	is_enabled = true;
+}
+
+bool ConcurrencyController::IsEnabled() const
+{
+	return is_enabled;
+}
+
+bool ConcurrencyController::Acquire(const std::atomic<bool>& stop)
+{
+	if (!is_enabled)
+		return true;
+
+	std::unique_lock lock(mutex);
+	while (in_flight >= GetWindow())
+	{
+		if (stop)
+			return false;
+
+		// Stop flag isn't tied to the condition, check it periodically
+		condition.wait_for(lock, std::chrono::milliseconds{ 100 });
+	}
+
+	++in_flight;
+	return true;
+}
+
+void ConcurrencyController::Release(const Clock::duration latency, const LatencySample& sample, const bool succeeded)
+{
+	if (!is_enabled)
+		return;
+
+	{
+		std::lock_guard lock(mutex);
+		// A window that wasn't filled says nothing about whether a wider one would work
+		const bool was_full = in_flight >= GetWindow();
+		--in_flight;
+		++completed;
+
+		const auto previous = GetWindow();
+		const auto now = Clock::now();
+		const auto latency_ms = std::chrono::duration<double, std::milli>(latency).count();
+
+		if (!succeeded)
+		{
+			++failed;
+			Decrease(now);
+		}
+		else if (IsCongested(sample))
+		{
+			Decrease(now);
+		}
+		else if (was_full)
+		{
+			limit = std::min<double>(max_limit, limit + 1.0 / limit);
+		}
+
+		if (succeeded)
+			average_ms = average_ms > 0 ? average_ms + (latency_ms - average_ms) * average_weight : latency_ms;
+
+		if (GetWindow() != previous)
+			history.emplace_back(std::chrono::duration_cast<std::chrono::milliseconds>(now - report_start).count(), GetWindow());
+	}
+
+	condition.notify_all();
+}
+
+void ConcurrencyController::Yield()
+{
+	if (!is_enabled)
+		return;
+
+	{
+		std::lock_guard lock(mutex);
+		--in_flight;
+	}
+
+	condition.notify_all();
+}
+
+void ConcurrencyController::Report(std::ostream& output)
+{
+	std::lock_guard lock(mutex);
+	if (!is_enabled || completed == 0)
+		return;
+
+	output << name << " concurrency: ";
+	for (size_t i = 0; i < history.size(); ++i)
+	{
+		if (history.size() > reported_changes && i == reported_changes / 2)
+		{
+			output << " -> ...";
+			i = history.size() - reported_changes / 2;
+		}
+
+		if (i != 0)
+			output << " -> ";
+		output << history[i].second;
+	}
+
+	output << " (" << completed << " tasks, " << failed << " failed, average " << static_cast<int64_t>(average_ms)
+		<< " ms, last change after " << history.back().first << " ms)" << std::endl;
+
+	completed = 0;
+	failed = 0;
+	report_start = Clock::now();
+	history = { { 0, GetWindow() } };
+}
+
+size_t ConcurrencyController::GetWindow() const
+{
+	return static_cast<size_t>(limit);
+}
+
+void ConcurrencyController::Decrease(const Clock::time_point now)
+{
+	// Tasks that started before the last decrease report on a window that no longer exists
+	if (average_ms > 0 && now - decreased_at < std::chrono::duration<double, std::milli>(average_ms))
+		return;
+
+	limit = std::max<double>(min_limit, limit / 2);
+	decreased_at = now;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ConcurrencyLimits;
+struct LatencySample;
+
+// Additive-increase/multiplicative-decrease limit on tasks of one resource class running at once.
+// Every success that completes with the window full widens it by 1/limit, which is about one slot per
+// round of tasks. A failed task, or one whose latency sample is far above what the same work took for
+// its repository before, halves it - at most once per average latency, so that a single congested round
+// isn't punished once per task. Raw task durations aren't compared, a large clone isn't congestion.
+class ConcurrencyController
+{
+public:
+	explicit ConcurrencyController(std::string name);
+
+	// Tasks run without limit until configured
+	void Configure(const ConcurrencyLimits& limits);
+	bool IsEnabled() const;
+
+	// Blocks until a slot is free, false when stop was raised meanwhile
+	bool Acquire(const std::atomic<bool>& stop);
+	void Release(std::chrono::steady_clock::duration latency, const LatencySample& sample, bool succeeded);
+	// Gives a slot back without judging the task holding it, for a task that waits on something else
+	// and then takes a slot again with Acquire
+	void Yield();
+
+	// Prints how the limit moved since the last report
+	void Report(std::ostream& output);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	const std::string name;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::atomic<bool> is_enabled{ false };
+
+	double limit = 1;
+	double min_limit = 1;
+	double max_limit = 1;
+	size_t in_flight = 0;
+
+	// Running average of successful task latencies, spaces out decreases
+	double average_ms = 0;
+	Clock::time_point decreased_at;
+
+	size_t completed = 0;
+	size_t failed = 0;
+	Clock::time_point report_start;
+	// Milliseconds since report_start and the window chosen then
+	std::vector<std::pair<int64_t, size_t>> history;
+
+	size_t GetWindow() const;
+	void Decrease(Clock::time_point now);
+};
@@ -1,5 +1,9 @@
 #include "Config.h"
 
+#include <algorithm>
+#include <charconv>
+#include <functional>
+
 namespace
 {
 	bool GitExists(const std::filesystem::path& path)
@@ -10,6 +14,14 @@ namespace
 	}
 }
 
+bool FetchConfig::Validate() const
+{
+    if (depth < 0 || ttl_seconds < 0 || cli_object_threshold < 0)
+        return false;
+
+    return filter.empty() || filter == "blob:none" || filter == "tree:0" || filter.starts_with("blob:limit=");
+}
+
 bool RepoConfig::Validate()
 {
 	const std::filesystem::path filepath{ path };
@@ -29,14 +41,143 @@ bool RepoConfig::Validate()
     return true;
 }
 
-bool Config::Validate()
+// Unlike a missing repository, which is only left out, invalid settings stop the run
+bool RepoConfig::ValidateSettings(std::ostream& error_stream) const
+{
+    bool is_valid = true;
+
+    if (!fetch.Validate())
+    {
+        error_stream << "Repository " << path << ": invalid fetch settings, check depth, ttl_seconds, cli_object_threshold and filter\n";
+        is_valid = false;
+    }
+
+    if (build.limits.cpu_weight > 10000)
+    {
+        error_stream << "Repository " << path << ": build limits cpu_weight must be at most 10000, got " << build.limits.cpu_weight << '\n';
+        is_valid = false;
+    }
+
+    if (!build.limits.unknown_priority.empty())
+    {
+        error_stream << "Repository " << path << ": build limits priority must be interactive, batch or idle, got \"" << build.limits.unknown_priority << "\"\n";
+        is_valid = false;
+    }
+
+    for (const auto& sub_repo : sub_repos)
+        is_valid &= sub_repo.ValidateSettings(error_stream);
+
+    return is_valid;
+}
+
+bool MemoryBudget::IsEnabled() const
+{
+    return limit_mb != 0;
+}
+
+bool ConcurrencyLimits::Validate() const
+{
+    return min >= 1 && min <= initial && initial <= max;
+}
+
+ConcurrencyLimits ConcurrencyLimits::ClampedTo(const size_t capacity) const
+{
+    if (capacity == 0)
+        return *this;
+
+    return { std::min<size_t>(initial, capacity), std::min<size_t>(min, capacity), std::min<size_t>(max, capacity) };
+}
+
+bool Config::Validate(std::ostream& error_stream)
 {
     bool is_valid = true;
 
+    if (!concurrency.network.Validate() || !concurrency.disk.Validate())
+    {
+        error_stream << "Concurrency limits must satisfy 1 <= min <= initial <= max\n";
+        return false;
+    }
+
+    bool are_settings_valid = true;
 	for (auto& repository : repositories)
+    {
         is_valid &= repository.Validate();
+        are_settings_valid &= repository.ValidateSettings(error_stream);
+    }
 
-    return true;
+    return are_settings_valid;
+}
+
+namespace
+{
+    // Reads the value of "--name=value", false when arg is another switch or the value isn't a number
+    bool ReadNumericArgument(const std::string& arg, const std::string_view& name, size_t& value)
+    {
+        if (!arg.starts_with(name) || arg.size() <= name.size() || arg[name.size()] != '=')
+            return false;
+
+        const auto first = arg.data() + name.size() + 1;
+        const auto last = arg.data() + arg.size();
+        const auto [end, error] = std::from_chars(first, last, value);
+        return error == std::errc{} && end == last;
+    }
+
+    void ApplyToRepositories(std::vector<RepoConfig>& repositories, const std::function<void(RepoConfig&)>& apply)
+    {
+        for (auto& repository : repositories)
+        {
+            apply(repository);
+            ApplyToRepositories(repository.sub_repos, apply);
+        }
+    }
+}
+
+void Config::ApplyArguments(const std::vector<std::string>& args)
+{
+    for (const auto& arg : args)
+    {
+        if (arg == "--prewarm")
+            prewarm = true;
+        else if (arg == "--narrow")
+            ApplyToRepositories(repositories, [](RepoConfig& repo) { repo.fetch.narrow = true; });
+        else if (arg == "--all-refs")
+            ApplyToRepositories(repositories, [](RepoConfig& repo) { repo.fetch.narrow = false; });
+        else if (arg == "--no-tags")
+            ApplyToRepositories(repositories, [](RepoConfig& repo) { repo.fetch.tags = false; });
+        else if (arg == "--tags")
+            ApplyToRepositories(repositories, [](RepoConfig& repo) { repo.fetch.tags = true; });
+        else if (arg == "--adaptive")
+            concurrency.adaptive = true;
+        else if (arg == "--refresh")
+            ApplyToRepositories(repositories, [](RepoConfig& repo) { repo.fetch.ttl_seconds = 0; });
+        else if (ReadNumericArgument(arg, "--bandwidth", network.bandwidth_limit_kb))
+            continue;
+        else if (ReadNumericArgument(arg, "--connections-per-host", network.connections_per_host))
+            continue;
+        else if (ReadNumericArgument(arg, "--jobs", jobs))
+            continue;
+    }
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, BuildStep& p)
+{
+    // Plain strings are commands with default scheduling
+    if (j.is_string())
+    {
+        j.get_to(p.command);
+        return;
+    }
+
+    j.at("command").get_to(p.command);
+    if (j.contains("weight"))
+        j.at("weight").get_to(p.weight);
+    if (j.contains("exclusive"))
+        j.at("exclusive").get_to(p.exclusive);
+    if (j.contains("timeout_seconds"))
+        j.at("timeout_seconds").get_to(p.timeout_seconds);
+    if (j.contains("inactivity_timeout_seconds"))
+        j.at("inactivity_timeout_seconds").get_to(p.inactivity_timeout_seconds);
 }
 
 // ReSharper disable once CppInconsistentNaming
@@ -48,6 +189,29 @@ void from_json(const nlohmann::json& j, ErrorHandling& p)
         j.at("before_retry").get_to(p.before_retry);
 }
 
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, ResourceLimits& p)
+{
+    if (j.contains("memory_max_mb"))
+        j.at("memory_max_mb").get_to(p.memory_max_mb);
+    if (j.contains("cpu_weight"))
+        j.at("cpu_weight").get_to(p.cpu_weight);
+    if (j.contains("max_processes"))
+        j.at("max_processes").get_to(p.max_processes);
+    if (j.contains("priority"))
+    {
+        const auto priority = j.at("priority").get<std::string>();
+        if (priority == "interactive")
+            p.scheduling = SchedulingClass::Interactive;
+        else if (priority == "batch")
+            p.scheduling = SchedulingClass::Batch;
+        else if (priority == "idle")
+            p.scheduling = SchedulingClass::Idle;
+        else
+            p.unknown_priority = priority;
+    }
+}
+
 // ReSharper disable once CppInconsistentNaming
 void from_json(const nlohmann::json& j, BuildConfig& p)
 {
@@ -61,10 +225,29 @@ void from_json(const nlohmann::json& j, BuildConfig& p)
         j.at("working_dir").get_to(p.working_dir);
     if (j.contains("env"))
         j.at("env").get_to(p.env);
+    if (j.contains("limits"))
+        j.at("limits").get_to(p.limits);
     if (j.contains("on_error"))
         j.at("on_error").get_to(p.on_error);
 }
 
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, FetchConfig& p)
+{
+    if (j.contains("depth"))
+        j.at("depth").get_to(p.depth);
+    if (j.contains("filter"))
+        j.at("filter").get_to(p.filter);
+    if (j.contains("narrow"))
+        j.at("narrow").get_to(p.narrow);
+    if (j.contains("tags"))
+        j.at("tags").get_to(p.tags);
+    if (j.contains("ttl_seconds"))
+        j.at("ttl_seconds").get_to(p.ttl_seconds);
+    if (j.contains("cli_object_threshold"))
+        j.at("cli_object_threshold").get_to(p.cli_object_threshold);
+}
+
 // ReSharper disable once CppInconsistentNaming
 void from_json(const nlohmann::json& j, RepoConfig& p)
 {
@@ -78,10 +261,96 @@ void from_json(const nlohmann::json& j, RepoConfig& p)
         j.at("build").get_to(p.build);
     if (j.contains("local_repo"))
         j.at("local_repo").get_to(p.local_repo);
+    if (j.contains("fetch"))
+        j.at("fetch").get_to(p.fetch);
+    if (j.contains("use_object_pool"))
+        j.at("use_object_pool").get_to(p.use_object_pool);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, MemoryBudget& p)
+{
+    if (j.contains("limit_mb"))
+        j.at("limit_mb").get_to(p.limit_mb);
+    if (j.contains("open_files"))
+        j.at("open_files").get_to(p.open_files);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, NetworkConfig& p)
+{
+    if (j.contains("bandwidth_limit_kb"))
+        j.at("bandwidth_limit_kb").get_to(p.bandwidth_limit_kb);
+    if (j.contains("connections_per_host"))
+        j.at("connections_per_host").get_to(p.connections_per_host);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, PoolConfig& p)
+{
+    if (j.contains("network"))
+        j.at("network").get_to(p.network);
+    if (j.contains("disk"))
+        j.at("disk").get_to(p.disk);
+    if (j.contains("cpu"))
+        j.at("cpu").get_to(p.cpu);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, DeviceLimits& p)
+{
+    if (j.contains("nvme"))
+        j.at("nvme").get_to(p.nvme);
+    if (j.contains("ssd"))
+        j.at("ssd").get_to(p.ssd);
+    if (j.contains("rotational"))
+        j.at("rotational").get_to(p.rotational);
+    if (j.contains("network"))
+        j.at("network").get_to(p.network);
+    if (j.contains("unknown"))
+        j.at("unknown").get_to(p.unknown);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, ConcurrencyLimits& p)
+{
+    if (j.contains("initial"))
+        j.at("initial").get_to(p.initial);
+    if (j.contains("min"))
+        j.at("min").get_to(p.min);
+    if (j.contains("max"))
+        j.at("max").get_to(p.max);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, ConcurrencyConfig& p)
+{
+    if (j.contains("adaptive"))
+        j.at("adaptive").get_to(p.adaptive);
+    if (j.contains("network"))
+        j.at("network").get_to(p.network);
+    if (j.contains("disk"))
+        j.at("disk").get_to(p.disk);
 }
 
 // ReSharper disable once CppInconsistentNaming
 void from_json(const nlohmann::json& j, Config& p)
 {
     j.at("repositories").get_to(p.repositories);
+    if (j.contains("memory_budget"))
+        j.at("memory_budget").get_to(p.memory_budget);
+    if (j.contains("network"))
+        j.at("network").get_to(p.network);
+    if (j.contains("pools"))
+        j.at("pools").get_to(p.pools);
+    if (j.contains("concurrency"))
+        j.at("concurrency").get_to(p.concurrency);
+    if (j.contains("devices"))
+        j.at("devices").get_to(p.devices);
+    if (j.contains("jobs"))
+        j.at("jobs").get_to(p.jobs);
+    if (j.contains("prewarm"))
+        j.at("prewarm").get_to(p.prewarm);
+    if (j.contains("object_pool"))
+        j.at("object_pool").get_to(p.object_pool);
 }
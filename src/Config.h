@@ -1,10 +1,46 @@
 #pragma once
+#include <ostream>
+
 #include "json.hpp"
 
+struct BuildStep
+{
+    std::string command;
+    // Share of the CPU pool taken while the step runs
+    size_t weight = 1;
+    // Runs with nothing else from the CPU pool
+    bool exclusive = false;
+    // Wall-clock limit and limit on time without output, 0 waits forever
+    size_t timeout_seconds = 0;
+    size_t inactivity_timeout_seconds = 0;
+};
+
 struct ErrorHandling
 {
     bool retry = false;
-    std::vector<std::string> before_retry;
+    std::vector<BuildStep> before_retry;
+};
+
+// How a step's processes compete with interactive work for CPU and memory
+enum class SchedulingClass : uint8_t
+{
+    Interactive,
+    // Below normal CPU and memory priority and a shorter quantum, the counterpart of SCHED_BATCH with a raised nice value
+    Batch,
+    // Runs only on otherwise idle CPUs with very low memory priority
+    Idle,
+};
+
+struct ResourceLimits
+{
+    // Caps the process tree of each build step, 0 leaves a limit unset
+    size_t memory_max_mb = 0;
+    // 1 - 10000 like cgroup cpu.weight, 100 is an even share
+    uint32_t cpu_weight = 0;
+    size_t max_processes = 0;
+    SchedulingClass scheduling = SchedulingClass::Interactive;
+    // "priority" value that names no scheduling class, reported by validation
+    std::string unknown_priority;
 };
 
 struct BuildConfig
@@ -12,44 +48,163 @@ struct BuildConfig
     std::string working_dir;
     std::vector<std::string> require;
     std::vector<std::string> require_pull;
-    std::vector<std::string> steps;
+    std::vector<BuildStep> steps;
     std::vector<std::string> env;
+    // Builds yield to interactive commands like status unless configured otherwise
+    ResourceLimits limits{ .scheduling = SchedulingClass::Batch };
     ErrorHandling on_error;
 };
 
+struct FetchConfig
+{
+    // 0 fetches full history
+    int depth = 0;
+    // Partial clone filter, e.g. "blob:none" or "tree:0"; fetched through git CLI
+    std::string filter;
+    // Fetch only default and current branch instead of every configured refspec
+    bool narrow = false;
+    bool tags = true;
+    // Remotes fetched within this many seconds are not fetched again, 0 always fetches
+    int64_t ttl_seconds = 0;
+    // Packs with more objects are fetched again by git, whose index-pack runs on every core; 0 keeps libgit2
+    int64_t cli_object_threshold = 0;
+
+    bool Validate() const;
+};
+
 struct RepoConfig
 {
     std::string path;
     std::string default_branch;
     std::string local_repo;
     bool hidden = false;
+    // Borrows objects from Config::object_pool when one is configured
+    bool use_object_pool = true;
 
     std::vector<RepoConfig> sub_repos;
 
     BuildConfig build;
+    FetchConfig fetch;
 
     // calculated
     std::string repo_name;
     uint8_t sub_repo_level = 0;
 
     bool Validate();
+    // Reports invalid settings of this repository and its sub repositories
+    bool ValidateSettings(std::ostream& error_stream) const;
+};
+
+struct MemoryBudget
+{
+    // 0 leaves libgit2 defaults untouched
+    size_t limit_mb = 0;
+    size_t open_files = 0;
+
+    bool IsEnabled() const;
+};
+
+struct NetworkConfig
+{
+    // Shared by every fetch of a run, 0 is unlimited
+    size_t bandwidth_limit_kb = 0;
+    // Concurrent connections to one remote host, 0 is unlimited
+    size_t connections_per_host = 0;
+};
+
+struct PoolConfig
+{
+    // Weight units admitted at once per resource class, 0 is unlimited.
+    // A set pool also caps the adaptive limit of its class.
+    size_t network = 0;
+    size_t disk = 0;
+    // 0 uses the number of hardware threads
+    size_t cpu = 0;
+};
+
+struct DeviceLimits
+{
+    // Disk-bound tasks running at once on one device of each kind, 0 is unlimited
+    size_t nvme = 32;
+    size_t ssd = 8;
+    size_t rotational = 2;
+    size_t network = 4;
+    size_t unknown = 0;
+};
+
+struct ConcurrencyLimits
+{
+    size_t initial = 8;
+    size_t min = 1;
+    size_t max = 64;
+
+    bool Validate() const;
+    // Limits that fit into a pool of the given capacity, 0 is unlimited
+    ConcurrencyLimits ClampedTo(size_t capacity) const;
+};
+
+struct ConcurrencyConfig
+{
+    // Fetches and status scans adapt how many of them run at once, otherwise all start together
+    bool adaptive = false;
+    ConcurrencyLimits network;
+    ConcurrencyLimits disk{ 4, 1, 32 };
 };
 
 struct Config
 {
     std::vector<RepoConfig> repositories;
+    MemoryBudget memory_budget;
+    NetworkConfig network;
+    PoolConfig pools;
+    ConcurrencyConfig concurrency;
+    DeviceLimits devices;
+    // Parallelism shared by every build step and the make or ninja processes they start, 0 disables the jobserver
+    size_t jobs = 0;
+    bool prewarm = false;
+    // Bare repository shared through alternates, fetched once per remote URL before pull; empty disables
+    std::string object_pool;
 
-    bool Validate();
+    bool Validate(std::ostream& error_stream);
+    // Command line switches override values read from the config file
+    void ApplyArguments(const std::vector<std::string>& args);
 };
 
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, BuildStep& p);
+
 // ReSharper disable once CppInconsistentNaming
 void from_json(const nlohmann::json& j, ErrorHandling& p);
 
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, ResourceLimits& p);
+
 // ReSharper disable once CppInconsistentNaming
 void from_json(const nlohmann::json& j, BuildConfig& p);
 
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, FetchConfig& p);
+
 // ReSharper disable once CppInconsistentNaming
 void from_json(const nlohmann::json& j, RepoConfig& p);
 
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, MemoryBudget& p);
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, NetworkConfig& p);
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, PoolConfig& p);
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, DeviceLimits& p);
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, ConcurrencyLimits& p);
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, ConcurrencyConfig& p);
+
 // ReSharper disable once CppInconsistentNaming
 void from_json(const nlohmann::json& j, Config& p);
@@ -4,3 +4,23 @@ RepositoryInformation::RepositoryInformation(const size_t sub_repo_level):
 	sub_repo_level(sub_repo_level)
 {
 }
+
+void TransferProgress::Store(const TransferStats& stats)
+{
+	received_objects = stats.received_objects;
+	indexed_objects = stats.indexed_objects;
+	total_objects = stats.total_objects;
+	indexed_deltas = stats.indexed_deltas;
+	total_deltas = stats.total_deltas;
+	received_bytes = stats.received_bytes;
+}
+
+TransferStats TransferProgress::Load() const
+{
+	return { received_objects, indexed_objects, total_objects, indexed_deltas, total_deltas, received_bytes };
+}
+
+void TransferProgress::Reset()
+{
+	Store({});
+}
@@ -1,11 +1,49 @@
 #pragma once
 #include <atomic>
+#include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <sstream>
 #include <string>
 
 class Task;
 
+// Counters reported by fetch transfer callbacks
+struct TransferStats
+{
+	unsigned received_objects = 0;
+	unsigned indexed_objects = 0;
+	unsigned total_objects = 0;
+	unsigned indexed_deltas = 0;
+	unsigned total_deltas = 0;
+	size_t received_bytes = 0;
+};
+
+// Latest stats of the running fetch, written by its task and sampled by displays
+struct TransferProgress
+{
+	std::atomic<unsigned> received_objects{ 0 };
+	std::atomic<unsigned> indexed_objects{ 0 };
+	std::atomic<unsigned> total_objects{ 0 };
+	std::atomic<unsigned> indexed_deltas{ 0 };
+	std::atomic<unsigned> total_deltas{ 0 };
+	std::atomic<size_t> received_bytes{ 0 };
+
+	void Store(const TransferStats& stats);
+	TransferStats Load() const;
+	void Reset();
+};
+
+// Resources used by the process tree of a step, filled when it exits
+struct ProcessUsage
+{
+	size_t peak_memory = 0;
+	int64_t cpu_time_ms = 0;
+	// An allocation was refused for crossing the job's memory limit
+	bool hit_memory_limit = false;
+};
+
 struct RepositoryInformation
 {
 	std::string current_branch;
@@ -14,12 +52,34 @@ struct RepositoryInformation
 	size_t files_added = 0;
 	size_t files_modified = 0;
 	size_t files_deleted = 0;
+	size_t commits_ahead = 0;
+	size_t commits_behind = 0;
 
 	std::atomic<bool> is_repo_found{ true };
 	std::atomic<bool> is_repo_detached{ false };
 	std::atomic<bool> no_of_files_complete{ false };
+	std::atomic<bool> ahead_behind_complete{ false };
+	std::atomic<bool> has_upstream{ false };
+	std::atomic<bool> is_ahead_behind_capped{ false };
 	std::atomic<bool> has_incoming{ false };
 	std::atomic<bool> has_only_local{ false };
+	std::atomic<bool> is_dirty{ false };
+	// Set after fetched_from names the repository that fetched the shared remote URL
+	std::atomic<bool> is_fetched_locally{ false };
+
+	std::atomic<int64_t> status_scan_ms{ -1 };
+	// Scan time stored by earlier runs, loaded from state before launch
+	int64_t previous_status_scan_ms = -1;
+
+	TransferProgress transfer;
+
+	// Unix time of the last successful fetch per remote, loaded from state before launch
+	std::map<std::string, int64_t> last_fetch_times;
+	// Connect latency per remote, stored values before launch and measured ones after
+	std::map<std::string, int64_t> connect_times;
+	std::string fetched_from;
+	// Pack and loose object files in the repository before pulling, the mirror only needs the others
+	std::optional<std::set<std::string>> objects_before_pull;
 
 	RepositoryInformation(size_t sub_repo_level);
 };
@@ -34,4 +94,5 @@ struct StepData
 
 	std::string error;
 	std::stringstream output;
+	ProcessUsage usage;
 };
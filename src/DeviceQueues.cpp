@@ -0,0 +1,184 @@
+#include "DeviceQueues.h"
+
+#include <ranges>
+#include <string_view>
+#include <utility>
+#include <Windows.h>
+#include <winioctl.h>
+
+#include "Config.h"
+
+DeviceQueues::Lease::Lease(DeviceQueues* queues, std::string device) :
+	queues(queues),
+	device(std::move(device))
+{
+}
+
+DeviceQueues::Lease::~Lease()
+{
+	if (queues)
+		queues->Release(device);
+}
+
+DeviceQueues::Lease::Lease(Lease&& other) noexcept :
+	queues(std::exchange(other.queues, nullptr)),
+	device(std::move(other.device))
+{
+}
+
+DeviceQueues::Lease& DeviceQueues::Lease::operator=(Lease&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (queues)
+			queues->Release(device);
+
+		queues = std::exchange(other.queues, nullptr);
+		device = std::move(other.device);
+	}
+	return *this;
+}
+
+void DeviceQueues::SetLimits(const DeviceLimits& device_limits)
+{
+	std::lock_guard lock(mutex);
+	limits = {
+		{ DeviceKind::Unknown, device_limits.unknown },
+		{ DeviceKind::Nvme, device_limits.nvme },
+		{ DeviceKind::Ssd, device_limits.ssd },
+		{ DeviceKind::Rotational, device_limits.rotational },
+		{ DeviceKind::Network, device_limits.network },
+	};
+
+	for (auto& device : devices | std::views::values)
+		device.limit = limits[device.kind];
+}
+
+bool DeviceQueues::Acquire(const std::string& path, const std::atomic<bool>& stop, Lease& lease)
+{
+	auto device_name = ResolveDevice(path);
+
+	std::unique_lock lock(mutex);
+	auto& device = devices.at(device_name);
+	if (device.limit == 0)
+		return true;
+
+	while (device.in_flight >= device.limit)
+	{
+		if (stop)
+			return false;
+
+		// Stop flag isn't tied to the condition, check it periodically
+		device.condition.wait_for(lock, std::chrono::milliseconds{ 100 });
+	}
+
+	++device.in_flight;
+	lease = Lease{ this, std::move(device_name) };
+	return true;
+}
+
+// Volume and storage queries can block on a busy or disconnected device, they run without holding the lock.
+// Tasks racing on a new path both resolve it and the first insert wins.
+std::string DeviceQueues::ResolveDevice(const std::string& path)
+{
+	{
+		std::lock_guard lock(mutex);
+		const auto path_it = device_of_path.find(path);
+		if (path_it != device_of_path.end())
+			return path_it->second;
+	}
+
+	auto device_name = GetDeviceName(path);
+
+	bool is_device_known;
+	{
+		std::lock_guard lock(mutex);
+		is_device_known = devices.contains(device_name);
+	}
+
+	const auto kind = is_device_known ? DeviceKind::Unknown : GetDeviceKind(device_name);
+
+	std::lock_guard lock(mutex);
+	device_of_path.emplace(path, device_name);
+
+	const auto [device_it, is_inserted] = devices.try_emplace(device_name);
+	if (is_inserted)
+	{
+		device_it->second.kind = kind;
+		device_it->second.limit = limits[kind];
+	}
+
+	return device_name;
+}
+
+void DeviceQueues::Release(const std::string& device_name)
+{
+	std::condition_variable* condition;
+	{
+		std::lock_guard lock(mutex);
+		auto& device = devices.at(device_name);
+		--device.in_flight;
+		condition = &device.condition;
+	}
+
+	condition->notify_all();
+}
+
+// Mount points of one volume resolve to the same volume name, network shares have none and keep their share path
+std::string DeviceQueues::GetDeviceName(const std::string& path)
+{
+	char volume_path[MAX_PATH];
+	if (!GetVolumePathNameA(path.c_str(), volume_path, MAX_PATH))
+		return path;
+
+	char volume_name[MAX_PATH];
+	if (GetVolumeNameForVolumeMountPointA(volume_path, volume_name, MAX_PATH))
+		return volume_name;
+
+	return volume_path;
+}
+
+DeviceKind DeviceQueues::GetDeviceKind(const std::string& device_name)
+{
+	if (GetDriveTypeA(device_name.c_str()) == DRIVE_REMOTE)
+		return DeviceKind::Network;
+
+	char file_system[MAX_PATH + 1];
+	if (GetVolumeInformationA(device_name.c_str(), nullptr, 0, nullptr, nullptr, nullptr, file_system, sizeof file_system)
+		&& std::string_view{ file_system } == "NFS")
+		return DeviceKind::Network;
+
+	// Volume device is opened by its name without the trailing backslash, property queries need no access rights
+	if (!device_name.starts_with(R"(\\?\Volume)") || !device_name.ends_with('\\'))
+		return DeviceKind::Unknown;
+
+	const auto device_path = device_name.substr(0, device_name.size() - 1);
+	const HANDLE handle = CreateFileA(device_path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return DeviceKind::Unknown;
+
+	DeviceKind kind = DeviceKind::Unknown;
+	DWORD returned = 0;
+
+	STORAGE_PROPERTY_QUERY query{};
+	query.PropertyId = StorageDeviceProperty;
+	query.QueryType = PropertyStandardQuery;
+
+	STORAGE_DEVICE_DESCRIPTOR descriptor{};
+	if (DeviceIoControl(handle, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof query, &descriptor, sizeof descriptor, &returned, nullptr)
+		&& descriptor.BusType == BusTypeNvme)
+	{
+		kind = DeviceKind::Nvme;
+	}
+	else
+	{
+		query.PropertyId = StorageDeviceSeekPenaltyProperty;
+
+		DEVICE_SEEK_PENALTY_DESCRIPTOR seek_penalty{};
+		if (DeviceIoControl(handle, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof query, &seek_penalty, sizeof seek_penalty, &returned, nullptr))
+			kind = seek_penalty.IncursSeekPenalty ? DeviceKind::Rotational : DeviceKind::Ssd;
+	}
+
+	CloseHandle(handle);
+	return kind;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+struct DeviceLimits;
+
+enum class DeviceKind : uint8_t
+{
+	Unknown,
+	Nvme,
+	Ssd,
+	Rotational,
+	Network,
+};
+
+// Disk-bound tasks queue per storage device, so that a spinning disk or a network share
+// that is being thrashed doesn't hold up repositories on faster devices
+class DeviceQueues
+{
+public:
+	class Lease
+	{
+	public:
+		Lease() = default;
+		Lease(DeviceQueues* queues, std::string device);
+		~Lease();
+
+		Lease(const Lease& other) = delete;
+		Lease(Lease&& other) noexcept;
+		Lease& operator=(const Lease& other) = delete;
+		Lease& operator=(Lease&& other) noexcept;
+
+	private:
+		DeviceQueues* queues = nullptr;
+		std::string device;
+	};
+
+	void SetLimits(const DeviceLimits& device_limits);
+
+	// Blocks until the device holding path has a free slot, false when stop was raised meanwhile
+	bool Acquire(const std::string& path, const std::atomic<bool>& stop, Lease& lease);
+
+private:
+	struct Device
+	{
+		DeviceKind kind = DeviceKind::Unknown;
+		size_t limit = 0;
+		size_t in_flight = 0;
+		std::condition_variable condition;
+	};
+
+	std::mutex mutex;
+	std::map<DeviceKind, size_t> limits;
+	// Keyed by volume name, the counterpart of st_dev
+	std::map<std::string, Device> devices;
+	// Device of each repository path seen, volume lookups are too slow to repeat for every task
+	std::map<std::string, std::string> device_of_path;
+
+	std::string ResolveDevice(const std::string& path);
+	void Release(const std::string& device_name);
+
+	static std::string GetDeviceName(const std::string& path);
+	static DeviceKind GetDeviceKind(const std::string& device_name);
+};
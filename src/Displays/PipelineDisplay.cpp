@@ -1,5 +1,7 @@
 #include "PipelineDisplay.h"
 
+#include <iomanip>
+
 #include "Config.h"
 #include "RepoOrchestrator.h"
 #include "OrderedMap.h"
@@ -20,6 +22,7 @@ size_t PipelineDisplay::Print(std::ostream& output, bool will_exit)
 
 	const std::pair<const std::string, std::shared_ptr<RepoOrchestrator>>* first_failed = nullptr;
 	const std::pair<const std::string, std::shared_ptr<RepoOrchestrator>>* first_ongoing = nullptr;
+	double network_rate = 0;
 
 	// iterate builds
 	for (const auto& d : data_collection)
@@ -53,10 +56,29 @@ size_t PipelineDisplay::Print(std::ostream& output, bool will_exit)
 			stage_stream << "Awaiting: " << repo_data->GetAwait();
 			break;
 		case OrchestratorStatus::Ongoing:
+		{
+			if (repo_data->IsQueued())
+			{
+				stage_stream << "Queued";
+				break;
+			}
+
 			stage_stream << "Building (" << repo_data->GetActiveId() << " / " << repo_data->GetSize() << ") - " << repo_data->GetActiveCommand();
+
+			const auto transfer = repo_info.transfer.Load();
+			if (transfer.total_objects > 0)
+			{
+				double rate = 0;
+				stage_stream << ' ' << FormatTransfer(repo_data.get(), transfer, rate);
+				network_rate += rate;
+				has_network_line = true;
+			}
 			break;
+		}
 		case OrchestratorStatus::Complete:
 			stage_stream << "Completed!";
+			if (repo_info.is_fetched_locally)
+				stage_stream << " (fetched locally from " << repo_info.fetched_from << ')';
 			break;
 		case OrchestratorStatus::Error:
 			stage_stream << "Error encountered!";
@@ -64,8 +86,8 @@ size_t PipelineDisplay::Print(std::ostream& output, bool will_exit)
 		}
 
 		std::string stage = stage_stream.str();
-		if (stage.size() > 80)
-			stage = stage.substr(0, 80);
+		if (stage.size() > 120)
+			stage = stage.substr(0, 120);
 		output << stage;
 		
 		// cleanup
@@ -82,6 +104,14 @@ size_t PipelineDisplay::Print(std::ostream& output, bool will_exit)
 		current_max_line = std::max(current_max_line, line_length);
 	}
 
+	if (has_network_line)
+	{
+		output << ClearSymbol << " Network: ";
+		PrintRate(output, network_rate);
+		output << std::endl;
+		lines_written++;
+	}
+
 	// build is taking long, what's going on?
 	if (std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - start_point).count() > 5)
 	{
@@ -129,6 +159,8 @@ size_t PipelineDisplay::Print(std::ostream& output, bool will_exit)
 		output << std::endl << "Output from failed repo: " << repo_config.repo_name << ": " << std::endl;
 		output << "Building (" << repo_data->GetActiveId() << " / " << repo_data->GetSize() << ") - " << repo_data->GetActiveCommand() << std::endl;
 		output << "Error: " << repo_data->GetErrorString() << std::endl;
+		if (const auto usage = repo_data->GetActiveUsage(); usage.peak_memory > 0)
+			output << "Peak memory: " << usage.peak_memory / (1024 * 1024) << " MiB, CPU time: " << usage.cpu_time_ms << " ms" << std::endl;
 		output << repo_data->GetActiveOutput() << std::endl << std::endl;
 		output << "Output above was from failed repo " << repo_config.repo_name << std::endl;
 	}
@@ -136,3 +168,53 @@ size_t PipelineDisplay::Print(std::ostream& output, bool will_exit)
 	last_max_line = current_max_line;
 	return lines_written;
 }
+
+// Progress bar with smoothed rate and ETA of the fetch a repository is running
+std::string PipelineDisplay::FormatTransfer(const RepoOrchestrator* orchestrator, const TransferStats& stats, double& bytes_per_second)
+{
+	const auto now = std::chrono::steady_clock::now();
+	auto& sample = transfer_samples[orchestrator];
+
+	// First sample, or a new fetch started on the same repository
+	if (sample.started_at == std::chrono::steady_clock::time_point{} || stats.received_bytes < sample.bytes)
+		sample = { stats.received_bytes, now, now, 0 };
+
+	const auto since_sample = std::chrono::duration<double>(now - sample.sampled_at).count();
+	if (since_sample >= 0.25)
+	{
+		const double rate = static_cast<double>(stats.received_bytes - sample.bytes) / since_sample;
+		sample.bytes_per_second = sample.bytes_per_second == 0 ? rate : sample.bytes_per_second * 0.7 + rate * 0.3;
+		sample.bytes = stats.received_bytes;
+		sample.sampled_at = now;
+	}
+
+	// Every object is received and indexed, deltas are resolved afterwards
+	const auto work_total = stats.total_objects * 2ull + stats.total_deltas;
+	const auto work_done = static_cast<unsigned long long>(stats.received_objects) + stats.indexed_objects + stats.indexed_deltas;
+	const double fraction = std::min<double>(1., static_cast<double>(work_done) / static_cast<double>(work_total));
+
+	constexpr size_t bar_width = 10;
+	const auto filled = static_cast<size_t>(fraction * bar_width);
+
+	std::stringstream stream;
+	stream << '[' << std::string(filled, '#') << std::string(bar_width - filled, '-') << "] "
+		<< static_cast<int>(fraction * 100) << "% ";
+
+	bytes_per_second = sample.bytes_per_second;
+	PrintRate(stream, bytes_per_second);
+
+	const auto elapsed = std::chrono::duration<double>(now - sample.started_at).count();
+	if (fraction > 0.01 && fraction < 1.)
+		stream << " ETA " << static_cast<int64_t>(elapsed * (1. - fraction) / fraction) << 's';
+
+	return stream.str();
+}
+
+void PipelineDisplay::PrintRate(std::ostream& output, const double bytes_per_second)
+{
+	output << std::fixed << std::setprecision(1);
+	if (bytes_per_second >= 1024. * 1024.)
+		output << bytes_per_second / (1024. * 1024.) << " MiB/s";
+	else output << bytes_per_second / 1024. << " KiB/s";
+	output << std::defaultfloat;
+}
@@ -1,8 +1,12 @@
 #pragma once
 #include <chrono>
+#include <string>
+#include <unordered_map>
 
 #include "Display.h"
 
+struct TransferStats;
+
 class PipelineDisplay final : public Display
 {
 public:
@@ -15,4 +19,20 @@ private:
 	size_t max_name_space = 0;
 	size_t last_max_line = 0;
 	std::chrono::system_clock::time_point start_point;
+
+	struct TransferSample
+	{
+		size_t bytes = 0;
+		std::chrono::steady_clock::time_point sampled_at;
+		std::chrono::steady_clock::time_point started_at;
+		double bytes_per_second = 0;
+	};
+
+	// Fetch rates are measured between prints, tasks only keep counters
+	std::unordered_map<const RepoOrchestrator*, TransferSample> transfer_samples;
+	// Bandwidth line stays once shown, so that the number of printed lines doesn't shrink
+	bool has_network_line = false;
+
+	std::string FormatTransfer(const RepoOrchestrator* orchestrator, const TransferStats& stats, double& bytes_per_second);
+	static void PrintRate(std::ostream& output, double bytes_per_second);
 };
@@ -77,6 +77,20 @@ size_t StatusDisplay::Print(std::ostream& output, bool will_exit)
                     output << "A: " << repo_info.files_added
                         << " M: " << repo_info.files_modified
                         << " D: " << repo_info.files_deleted;
+
+                    if (repo_info.ahead_behind_complete)
+                    {
+                        if (repo_info.has_upstream)
+                        {
+                            const char* capped_mark = repo_info.is_ahead_behind_capped ? "+" : "";
+                            output << "    ahead: " << repo_info.commits_ahead << capped_mark
+                                << " behind: " << repo_info.commits_behind << capped_mark;
+                        }
+                        else
+                        {
+                            output << "    no upstream";
+                        }
+                    }
                 }
             }
         }
@@ -0,0 +1,60 @@
+#include "FetchCoordinator.h"
+
+#include <chrono>
+
+bool FetchCoordinator::Claim(const std::string& url, const Source& source)
+{
+	std::lock_guard lock(mutex);
+	return entries.try_emplace(Normalize(url), Entry{ source }).second;
+}
+
+void FetchCoordinator::Complete(const std::string& url, const bool succeeded)
+{
+	{
+		std::lock_guard lock(mutex);
+		const auto it = entries.find(Normalize(url));
+		if (it == entries.end())
+			return;
+
+		it->second.state = succeeded ? FetchState::Succeeded : FetchState::Failed;
+	}
+
+	condition.notify_all();
+}
+
+bool FetchCoordinator::WaitFor(const std::string& url, const std::atomic<bool>& stop, Source& source)
+{
+	const auto key = Normalize(url);
+
+	std::unique_lock lock(mutex);
+	while (!stop)
+	{
+		const auto it = entries.find(key);
+		if (it == entries.end())
+			return false;
+
+		if (it->second.state != FetchState::Ongoing)
+		{
+			source = it->second.source;
+			return it->second.state == FetchState::Succeeded;
+		}
+
+		// Stop flag isn't tied to the condition, check it periodically
+		condition.wait_for(lock, std::chrono::milliseconds{ 100 });
+	}
+
+	return false;
+}
+
+// "https://host/repo.git/" and "https://host/repo" point to the same repository
+std::string FetchCoordinator::Normalize(const std::string& url)
+{
+	std::string normalized = url;
+	while (!normalized.empty() && (normalized.back() == '/' || normalized.back() == '\\'))
+		normalized.pop_back();
+
+	if (normalized.ends_with(".git"))
+		normalized.resize(normalized.size() - 4);
+
+	return normalized;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Lets one repository per run fetch a remote URL over the network. Repositories
+// sharing the URL wait for it and then fetch from its clone through the local transport.
+class FetchCoordinator
+{
+public:
+	struct Source
+	{
+		std::string path;
+		std::string remote_name;
+		std::string repo_name;
+	};
+
+	// True when the caller owns the network fetch of url and has to report it with Complete
+	bool Claim(const std::string& url, const Source& source);
+	void Complete(const std::string& url, bool succeeded);
+
+	// Blocks until the owner of url completes, false when it failed or stop was requested
+	bool WaitFor(const std::string& url, const std::atomic<bool>& stop, Source& source);
+
+private:
+	enum class FetchState : uint8_t
+	{
+		Ongoing,
+		Succeeded,
+		Failed,
+	};
+
+	struct Entry
+	{
+		Source source;
+		FetchState state = FetchState::Ongoing;
+	};
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::unordered_map<std::string, Entry> entries;
+
+	static std::string Normalize(const std::string& url);
+};
@@ -1,11 +1,19 @@
 #include "GitLibLock.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 #include <git2.h>
 
-GitLibLock::GitLibLock()
+#include "CommitGraph.h"
+#include "GitLibRuntime.h"
+
+GitLibLock::GitLibLock() :
+	runtime(GitLibRuntime::Instance())
 {
-	git_libgit2_init();
 }
 
 GitLibLock::~GitLibLock()
@@ -22,10 +30,7 @@ GitLibLock::~GitLibLock()
 	if (status_list)
 		git_status_list_free(status_list);
 
-	if (repository)
-		git_repository_free(repository);
-
-	git_libgit2_shutdown();
+	runtime.ReleaseRepository(repository);
 }
 
 bool GitLibLock::OpenRepo(const std::string_view& path)
@@ -33,7 +38,53 @@ bool GitLibLock::OpenRepo(const std::string_view& path)
 	if (repository)
 		return false;
 
-	return git_repository_open_ext(&repository, path.data(), GIT_REPOSITORY_OPEN_NO_SEARCH, "") == GIT_ERROR_NONE;
+	repository = runtime.LeaseRepository(path);
+	return repository != nullptr;
+}
+
+bool GitLibLock::OpenOrCreateBareRepo(const std::string_view& path)
+{
+	if (OpenRepo(path))
+		return true;
+
+	git_repository* created = nullptr;
+	if (git_repository_init(&created, std::string{ path }.c_str(), 1) != GIT_OK)
+		return false;
+	git_repository_free(created);
+
+	return OpenRepo(path);
+}
+
+// Appends to objects/info/alternates and to the odb shared by pooled handles of this repository
+bool GitLibLock::AddAlternate(const std::string& objects_path)
+{
+	if (!repository)
+		return false;
+
+	const auto alternates_path = std::filesystem::path{ git_repository_commondir(repository) } / "objects" / "info" / "alternates";
+
+	std::ifstream alternates_in{ alternates_path };
+	for (std::string line; std::getline(alternates_in, line);)
+		if (line == objects_path)
+			return true;
+	alternates_in.close();
+
+	std::error_code error_code;
+	create_directories(alternates_path.parent_path(), error_code);
+
+	std::ofstream alternates_out{ alternates_path, std::ios::app };
+	if (!alternates_out.is_open())
+		return false;
+	alternates_out << objects_path << '\n';
+	alternates_out.close();
+
+	git_odb* odb = nullptr;
+	if (git_repository_odb(&odb, repository) != GIT_OK)
+		return false;
+
+	const auto error = git_odb_add_disk_alternate(odb, objects_path.c_str());
+	git_odb_free(odb);
+	return error == GIT_OK;
 }
 
 bool GitLibLock::LookupRemote(const std::string_view& name)
@@ -58,7 +109,7 @@ namespace ConnectToRemoteUtils
 	struct ConnectData
 	{
 		std::function<int(const char*)>& remote_text_callback;
-		std::function<int(unsigned, unsigned, size_t)>& transfer_callback;
+		std::function<int(const TransferStats&)>& transfer_callback;
 	};
 
 	int RemoteTextCallback(const char* str, int, void* user_data)
@@ -70,9 +121,11 @@ namespace ConnectToRemoteUtils
 	int TransferProgressCallback(const git_indexer_progress* progress, void* user_data)
 	{
 		const auto fetch_data = static_cast<ConnectData*>(user_data);
-		const unsigned processed = progress->indexed_deltas + progress->indexed_objects + progress->received_objects;
-		const unsigned total = progress->total_deltas + progress->total_objects * 2;
-		return fetch_data->transfer_callback(processed, total, progress->received_bytes);
+		const TransferStats stats{
+			progress->received_objects, progress->indexed_objects, progress->total_objects,
+			progress->indexed_deltas, progress->total_deltas, progress->received_bytes
+		};
+		return fetch_data->transfer_callback(stats);
 	}
 
 	int CopyOid(const char* _, const char* unused,
@@ -89,13 +142,13 @@ namespace ConnectToRemoteUtils
 bool GitLibLock::ConnectToRemote(const std::string_view& remote_name)
 {
 	std::function<int(const char*)> f1 = [](const char*) {return 0; };
-	std::function<int(unsigned, unsigned, size_t)> f2 = [](unsigned, unsigned, size_t) {return 0; };
+	std::function<int(const TransferStats&)> f2 = [](const TransferStats&) {return 0; };
 
 	return ConnectToRemote(f1, f2, remote_name);
 }
 
 bool GitLibLock::ConnectToRemote(std::function<int(const char*)>& remote_text_callback,
-                                 std::function<int(unsigned, unsigned, size_t)>& progress_callback,	
+                                 std::function<int(const TransferStats&)>& progress_callback,	
 								 const std::string_view& remote_name)
 {
 	if (!LookupRemote(remote_name))
@@ -114,13 +167,18 @@ bool GitLibLock::ConnectToRemote(std::function<int(const char*)>& remote_text_ca
 }
 
 bool GitLibLock::Fetch(std::function<int(const char*)>& remote_text_callback,
-	std::function<int(unsigned, unsigned, size_t)>& progress_callback,
-	const std::string_view& remote_name)
+	std::function<int(const TransferStats&)>& progress_callback,
+	const std::string_view& remote_name, const GitFetchSettings& settings)
 {
 	if (!repository)
 		return false;
 
-	if (!LookupRemote(remote_name))
+	// A remote left connected by ConnectToRemote already holds the ref advertisement,
+	// fetching over it saves a second handshake
+	const char* connected_name = remote && git_remote_connected(remote) ? git_remote_name(remote) : nullptr;
+	const bool is_connected = connected_name && remote_name == connected_name;
+
+	if (!is_connected && !LookupRemote(remote_name))
 		return false;
 
 	using namespace ConnectToRemoteUtils;
@@ -130,11 +188,86 @@ bool GitLibLock::Fetch(std::function<int(const char*)>& remote_text_callback,
 	fetch_options.callbacks.transfer_progress = &TransferProgressCallback;
 	fetch_options.callbacks.sideband_progress = &RemoteTextCallback;
 	fetch_options.callbacks.payload = &connect_data;
-
-	const auto error = git_remote_fetch(remote, nullptr, &fetch_options, nullptr);
+	fetch_options.depth = settings.depth;
+	if (!settings.download_tags)
+		fetch_options.download_tags = GIT_REMOTE_DOWNLOAD_TAGS_NONE;
+	fetch_options.update_fetchhead = settings.update_fetchhead;
+
+	std::vector<char*> refspec_pointers;
+	for (const auto& refspec : settings.refspecs)
+		refspec_pointers.push_back(const_cast<char*>(refspec.c_str()));
+	const git_strarray refspecs{ refspec_pointers.data(), refspec_pointers.size() };
+	const git_strarray* active_refspecs = refspec_pointers.empty() ? nullptr : &refspecs;
+
+	if (!is_connected)
+		return git_remote_fetch(remote, active_refspecs, &fetch_options, nullptr) == GIT_OK;
+
+	// Same steps as git_remote_fetch, minus the connect
+	const auto reflog_message = std::string{ "fetch " } + connected_name;
+
+	auto error = git_remote_download(remote, active_refspecs, &fetch_options);
+	if (error == GIT_OK)
+		error = git_remote_update_tips(remote, &fetch_options.callbacks, settings.update_fetchhead ? GIT_REMOTE_UPDATE_FETCHHEAD : 0,
+			fetch_options.download_tags, reflog_message.c_str());
+	if (error == GIT_OK && git_remote_prune_refs(remote))
+		error = git_remote_prune(remote, &fetch_options.callbacks);
+
+	git_remote_disconnect(remote);
 	return error == GIT_OK;
 }
 
+bool GitLibLock::GetRemoteUrl(const std::string_view& name, std::string& url)
+{
+	if (!LookupRemote(name))
+		return false;
+
+	const char* remote_url = git_remote_url(remote);
+	if (!remote_url)
+		return false;
+
+	url = remote_url;
+	return true;
+}
+
+bool GitLibLock::FetchUrl(std::function<int(const char*)>& remote_text_callback,
+	std::function<int(const TransferStats&)>& progress_callback,
+	const std::string& url, const GitFetchSettings& settings)
+{
+	if (!repository)
+		return false;
+
+	if (remote)
+	{
+		git_remote_free(remote);
+		remote = nullptr;
+	}
+
+	if (git_remote_create_anonymous(&remote, repository, url.c_str()) != GIT_OK)
+		return false;
+
+	using namespace ConnectToRemoteUtils;
+	ConnectData connect_data{ remote_text_callback, progress_callback };
+
+	git_fetch_options fetch_options = GIT_FETCH_OPTIONS_INIT;
+	fetch_options.callbacks.transfer_progress = &TransferProgressCallback;
+	fetch_options.callbacks.sideband_progress = &RemoteTextCallback;
+	fetch_options.callbacks.payload = &connect_data;
+	fetch_options.depth = settings.depth;
+	if (!settings.download_tags)
+		fetch_options.download_tags = GIT_REMOTE_DOWNLOAD_TAGS_NONE;
+	fetch_options.update_fetchhead = settings.update_fetchhead;
+	// Anonymous remotes write only the destinations of the given refspecs, fetch.prune must not remove any of them
+	fetch_options.prune = GIT_FETCH_NO_PRUNE;
+
+	std::vector<char*> refspec_pointers;
+	for (const auto& refspec : settings.refspecs)
+		refspec_pointers.push_back(const_cast<char*>(refspec.c_str()));
+	const git_strarray refspecs{ refspec_pointers.data(), refspec_pointers.size() };
+
+	const auto reflog_message = "fetch " + url;
+	return git_remote_fetch(remote, refspec_pointers.empty() ? nullptr : &refspecs, &fetch_options, reflog_message.c_str()) == GIT_OK;
+}
+
 bool GitLibLock::Pull(const std::string_view& remote_name)
 {
 	if (!repository)
@@ -198,7 +331,30 @@ bool GitLibLock::GetBranchData(bool& is_detached, std::string& branch_or_sha)
 	return true;
 }
 
-bool GitLibLock::GetFileModificationStats(const bool& interrupt, size_t& added, size_t& modified, size_t deleted)
+bool GitLibLock::GetUpstreamBranch(const std::string& branch, std::string& upstream_branch)
+{
+	upstream_branch.clear();
+	if (!repository)
+		return false;
+
+	git_buf merge = GIT_BUF_INIT;
+	const auto reference_name = "refs/heads/" + branch;
+	const auto error = git_branch_upstream_merge(&merge, repository, reference_name.c_str());
+	if (error == GIT_ENOTFOUND)
+		return true;
+	if (error != GIT_OK)
+		return false;
+
+	upstream_branch = merge.ptr;
+	git_buf_dispose(&merge);
+
+	constexpr std::string_view branch_prefix = "refs/heads/";
+	if (upstream_branch.starts_with(branch_prefix))
+		upstream_branch.erase(0, branch_prefix.size());
+	return true;
+}
+
+bool GitLibLock::GetFileModificationStats(const std::atomic<bool>& interrupt, size_t& added, size_t& modified, size_t& deleted)
 {
 	constexpr static git_status_options Opts = GIT_STATUS_OPTIONS_INIT;
 
@@ -226,6 +382,188 @@ bool GitLibLock::GetFileModificationStats(const bool& interrupt, size_t& added,
 	return true;
 }
 
+namespace AheadBehindUtils
+{
+	constexpr uint8_t FromLocal = 1;
+	constexpr uint8_t FromUpstream = 2;
+	constexpr uint8_t FromBoth = FromLocal | FromUpstream;
+	constexpr uint8_t Stale = 4;
+
+	struct WalkNode
+	{
+		int64_t time = 0;
+		std::vector<std::string> parents;
+		uint8_t flags = 0;
+		bool queued = false;
+	};
+
+	// Commits are keyed by their raw oid bytes
+	std::string ToKey(const unsigned char* oid)
+	{
+		return { reinterpret_cast<const char*>(oid), CommitGraph::OidSize };
+	}
+
+	bool ReadCommit(git_repository* repository, const CommitGraph& graph, const std::string& key, WalkNode& node)
+	{
+		uint32_t position;
+		if (graph.Find(reinterpret_cast<const unsigned char*>(key.data()), position))
+		{
+			std::vector<uint32_t> parent_positions;
+			if (!graph.GetParents(position, parent_positions))
+				return false;
+
+			node.time = graph.GetCommitTime(position);
+			for (const auto parent_position : parent_positions)
+			{
+				const auto* parent_oid = graph.GetOid(parent_position);
+				if (!parent_oid)
+					return false;
+				node.parents.push_back(ToKey(parent_oid));
+			}
+			return true;
+		}
+
+		// Commits newer than the commit-graph file are read from the object database
+		git_oid oid;
+		memcpy(oid.id, key.data(), CommitGraph::OidSize);
+
+		git_commit* commit;
+		if (git_commit_lookup(&commit, repository, &oid) != GIT_OK)
+			return false;
+
+		node.time = git_commit_time(commit);
+		const unsigned int parent_count = git_commit_parentcount(commit);
+		for (unsigned int i = 0; i < parent_count; ++i)
+			if (const git_oid* parent_oid = git_commit_parent_id(commit, i))
+				node.parents.push_back(ToKey(parent_oid->id));
+
+		git_commit_free(commit);
+		return true;
+	}
+
+	// Paints both histories newest first until only common ancestry is left in the queue,
+	// the same way merge-base does, but gives up after walk_limit commits
+	class BoundedWalk
+	{
+	public:
+		BoundedWalk(git_repository* repository, const CommitGraph& graph) :
+			repository(repository),
+			graph(graph)
+		{
+		}
+
+		void Run(const git_oid& local_oid, const git_oid& upstream_oid, const size_t walk_limit,
+			size_t& ahead, size_t& behind, bool& is_capped)
+		{
+			Add(ToKey(local_oid.id), FromLocal);
+			Add(ToKey(upstream_oid.id), FromUpstream);
+
+			size_t steps = 0;
+			while (!queue.empty() && non_stale_queued > 0)
+			{
+				if (steps++ >= walk_limit)
+				{
+					is_capped = true;
+					return;
+				}
+
+				const std::string key = queue.top().second;
+				queue.pop();
+
+				auto& node = nodes.at(key);
+				node.queued = false;
+
+				uint8_t flags = node.flags;
+				if (!(flags & Stale))
+					--non_stale_queued;
+
+				if ((flags & FromBoth) == FromBoth)
+					flags |= Stale;
+				else if (!(flags & Stale) && flags == FromLocal)
+					++ahead;
+				else if (!(flags & Stale) && flags == FromUpstream)
+					++behind;
+
+				node.flags = flags;
+
+				for (const auto& parent : node.parents)
+					Add(parent, flags);
+			}
+		}
+
+	private:
+		git_repository* repository;
+		const CommitGraph& graph;
+
+		std::unordered_map<std::string, WalkNode> nodes;
+		std::priority_queue<std::pair<int64_t, std::string>> queue;
+		size_t non_stale_queued = 0;
+
+		void Add(const std::string& key, const uint8_t flags)
+		{
+			auto [it, inserted] = nodes.try_emplace(key);
+			auto& node = it->second;
+
+			// Missing parents (shallow history) simply end the walk on that side
+			if (inserted && !ReadCommit(repository, graph, key, node))
+			{
+				nodes.erase(it);
+				return;
+			}
+
+			const uint8_t old_flags = node.flags;
+			node.flags |= flags;
+			if (node.flags == old_flags)
+				return;
+
+			if (node.queued)
+			{
+				if (!(old_flags & Stale) && (node.flags & Stale))
+					--non_stale_queued;
+				return;
+			}
+
+			node.queued = true;
+			queue.emplace(node.time, key);
+			if (!(node.flags & Stale))
+				++non_stale_queued;
+		}
+	};
+}
+
+bool GitLibLock::GetAheadBehind(const size_t walk_limit, bool& has_upstream, size_t& ahead, size_t& behind, bool& is_capped)
+{
+	has_upstream = false;
+	is_capped = false;
+	ahead = 0;
+	behind = 0;
+
+	if (!head)
+		if (!GetHead())
+			return false;
+
+	if (!git_reference_is_branch(head))
+		return true;
+
+	git_oid upstream_oid;
+	if (!GetUpstreamId(upstream_oid))
+		return true;
+	has_upstream = true;
+
+	git_oid local_oid;
+	if (git_reference_name_to_id(&local_oid, repository, "HEAD") != GIT_OK)
+		return false;
+
+	CommitGraph graph;
+	graph.Open(std::filesystem::path{ git_repository_commondir(repository) } / "objects");
+
+	using namespace AheadBehindUtils;
+	BoundedWalk walk(repository, graph);
+	walk.Run(local_oid, upstream_oid, walk_limit, ahead, behind, is_capped);
+
+	return true;
+}
+
 bool GitLibLock::HasIncoming()
 {
 	if (!head)
@@ -253,6 +591,403 @@ bool GitLibLock::HasIncoming()
 	return false;
 }
 
+bool GitLibLock::HasAdvertisedIncoming(const std::string_view& remote_name, bool& has_incoming)
+{
+	has_incoming = false;
+
+	if (!remote || !git_remote_connected(remote))
+		return false;
+
+	if (!head)
+		if (!GetHead())
+			return false;
+
+	if (!git_reference_is_branch(head))
+		return true;
+
+	const git_remote_head** heads;
+	size_t heads_count;
+	if (git_remote_ls(&heads, &heads_count, remote) != GIT_OK)
+		return false;
+
+	const auto branch = git_reference_shorthand(head);
+	const auto advertised_branch = std::string{ "refs/heads/" } + branch;
+	const auto tracking_branch = std::string{ "refs/remotes/" } + std::string{ remote_name } + '/' + branch;
+
+	for (size_t i = 0; i < heads_count; ++i)
+	{
+		if (advertised_branch != heads[i]->name)
+			continue;
+
+		// Remote didn't move since the last fetch, nothing new to download
+		git_oid tracking_oid;
+		if (git_reference_name_to_id(&tracking_oid, repository, tracking_branch.c_str()) == GIT_OK
+			&& git_oid_equal(&tracking_oid, &heads[i]->oid))
+			break;
+
+		// Remote moved, but the advertised commit may already be merged locally
+		git_oid local_oid;
+		if (git_reference_name_to_id(&local_oid, repository, "HEAD") == GIT_OK)
+		{
+			if (git_oid_equal(&local_oid, &heads[i]->oid))
+				break;
+
+			git_odb* odb = nullptr;
+			const bool is_known = git_repository_odb(&odb, repository) == GIT_OK && git_odb_exists(odb, &heads[i]->oid);
+			if (odb)
+				git_odb_free(odb);
+
+			if (is_known && git_graph_descendant_of(repository, &local_oid, &heads[i]->oid) == 1)
+				break;
+		}
+
+		has_incoming = true;
+		break;
+	}
+
+	git_remote_disconnect(remote);
+	return true;
+}
+
+// Updates the refs that fetching with settings would update, for advertised branches whose commits are
+// already in the local odb. Refs go through the same refspecs as in a fetch, the remote's own when settings
+// has none, and are pruned when the remote prunes. Tags that are present are created the same way.
+// Refspecs of branches that still need a download are returned in missing_refspecs, in which case the remote
+// is left connected so that Fetch can reuse the advertisement.
+bool GitLibLock::UpdatePresentAdvertised(const std::string_view& remote_name, const GitFetchSettings& settings,
+	std::vector<std::string>& missing_refspecs)
+{
+	missing_refspecs.clear();
+
+	if (!repository || !remote || !git_remote_connected(remote))
+		return false;
+
+	const git_remote_head** heads;
+	size_t heads_count;
+	if (git_remote_ls(&heads, &heads_count, remote) != GIT_OK)
+		return false;
+
+	std::vector<git_refspec*> parsed_refspecs;
+	std::vector<const git_refspec*> refspecs;
+	bool result = true;
+	for (const auto& refspec : settings.refspecs)
+	{
+		git_refspec* parsed = nullptr;
+		result &= git_refspec_parse(&parsed, refspec.c_str(), 1) == GIT_OK;
+		if (parsed)
+			parsed_refspecs.push_back(parsed);
+	}
+	refspecs.assign(parsed_refspecs.begin(), parsed_refspecs.end());
+
+	if (settings.refspecs.empty())
+	{
+		for (size_t i = 0, count = git_remote_refspec_count(remote); i < count; ++i)
+		{
+			const auto* refspec = git_remote_get_refspec(remote, i);
+			if (git_refspec_direction(refspec) == GIT_DIRECTION_FETCH)
+				refspecs.push_back(refspec);
+		}
+	}
+
+	git_odb* odb = nullptr;
+	result = result && git_repository_odb(&odb, repository) == GIT_OK;
+
+	const std::string_view branch_prefix = "refs/heads/";
+	const std::string_view tag_prefix = "refs/tags/";
+	const auto reflog_message = std::string{ "fetch " } + std::string{ remote_name } + ": objects already present";
+	std::vector<std::string> advertised_branches;
+
+	for (size_t i = 0; i < heads_count && result; ++i)
+	{
+		const std::string_view name = heads[i]->name;
+
+		if (name.starts_with(branch_prefix))
+		{
+			advertised_branches.emplace_back(name);
+
+			for (const auto* refspec : refspecs)
+			{
+				if (!git_refspec_src_matches(refspec, heads[i]->name))
+					continue;
+
+				git_buf destination = GIT_BUF_INIT;
+				if (git_refspec_transform(&destination, refspec, heads[i]->name) != GIT_OK)
+				{
+					result = false;
+					break;
+				}
+
+				const std::string destination_name = destination.ptr;
+				git_buf_dispose(&destination);
+
+				const bool is_forced = git_refspec_force(refspec);
+				if (!git_odb_exists(odb, &heads[i]->oid))
+				{
+					missing_refspecs.push_back((is_forced ? "+" : "") + std::string{ name } + ':' + destination_name);
+					continue;
+				}
+
+				// Without force only fast-forwards are taken, same as fetch
+				git_oid current_oid;
+				if (!is_forced && git_reference_name_to_id(&current_oid, repository, destination_name.c_str()) == GIT_OK
+					&& !git_oid_equal(&current_oid, &heads[i]->oid)
+					&& git_graph_descendant_of(repository, &heads[i]->oid, &current_oid) != 1)
+					continue;
+
+				git_reference* reference = nullptr;
+				result = git_reference_create(&reference, repository, destination_name.c_str(), &heads[i]->oid, 1, reflog_message.c_str()) == GIT_OK;
+				if (reference)
+					git_reference_free(reference);
+			}
+		}
+		// Peeled entries are not refs, existing tags are never moved by a fetch either
+		else if (settings.download_tags && name.starts_with(tag_prefix) && !name.ends_with("^{}") && git_odb_exists(odb, &heads[i]->oid))
+		{
+			git_reference* reference = nullptr;
+			const auto error = git_reference_create(&reference, repository, heads[i]->name, &heads[i]->oid, 0, reflog_message.c_str());
+			result = error == GIT_OK || error == GIT_EEXISTS;
+			if (reference)
+				git_reference_free(reference);
+		}
+	}
+
+	// Refs whose source branch is no longer advertised, as git_remote_prune would remove them
+	git_strarray references{};
+	if (result && git_remote_prune_refs(remote) && git_reference_list(&references, repository) == GIT_OK)
+	{
+		for (size_t i = 0; i < references.count && result; ++i)
+		{
+			for (const auto* refspec : refspecs)
+			{
+				if (!git_refspec_dst_matches(refspec, references.strings[i]))
+					continue;
+
+				git_buf source = GIT_BUF_INIT;
+				if (git_refspec_rtransform(&source, refspec, references.strings[i]) != GIT_OK)
+					continue;
+
+				const std::string source_name = source.ptr;
+				git_buf_dispose(&source);
+
+				if (source_name.starts_with(branch_prefix) && std::ranges::find(advertised_branches, source_name) == advertised_branches.end())
+				{
+					const auto error = git_reference_remove(repository, references.strings[i]);
+					result = error == GIT_OK || error == GIT_ENOTFOUND;
+				}
+				break;
+			}
+		}
+
+		git_strarray_dispose(&references);
+	}
+
+	if (odb)
+		git_odb_free(odb);
+	for (auto* refspec : parsed_refspecs)
+		git_refspec_free(refspec);
+
+	if (!result || missing_refspecs.empty())
+		git_remote_disconnect(remote);
+	return result;
+}
+
+// Own objects directory first, followed by the ones listed in objects/info/alternates
+bool GitLibLock::GetObjectDirectories(std::vector<std::filesystem::path>& directories)
+{
+	if (!repository)
+		return false;
+
+	const auto objects_path = std::filesystem::path{ git_repository_commondir(repository) } / "objects";
+	directories.push_back(objects_path);
+
+	std::ifstream alternates{ objects_path / "info" / "alternates" };
+	for (std::string line; std::getline(alternates, line);)
+	{
+		if (line.empty() || line.front() == '#')
+			continue;
+
+		std::filesystem::path alternate{ line };
+		if (alternate.is_relative())
+			alternate = objects_path / alternate;
+		directories.push_back(alternate);
+	}
+
+	return true;
+}
+
+bool GitLibLock::GetReferenceTarget(const std::string& reference_name, std::string& oid)
+{
+	if (!repository)
+		return false;
+
+	git_oid target;
+	const auto error = git_reference_name_to_id(&target, repository, reference_name.c_str());
+	if (error == GIT_ENOTFOUND)
+	{
+		oid.clear();
+		return true;
+	}
+
+	if (error != GIT_OK)
+		return false;
+
+	char buffer[GIT_OID_SHA1_HEXSIZE + 1];
+	oid = git_oid_tostr(buffer, sizeof buffer, &target);
+	return true;
+}
+
+bool GitLibLock::ListReferences(const std::string& glob, std::map<std::string, std::string>& targets)
+{
+	git_reference_iterator* iterator = nullptr;
+	if (!repository || git_reference_iterator_glob_new(&iterator, repository, glob.c_str()) != GIT_OK)
+		return false;
+
+	char buffer[GIT_OID_SHA1_HEXSIZE + 1];
+	git_reference* reference = nullptr;
+	int error;
+	while ((error = git_reference_next(&reference, iterator)) == GIT_OK)
+	{
+		if (const git_oid* target = git_reference_target(reference))
+			targets[git_reference_name(reference)] = git_oid_tostr(buffer, sizeof buffer, target);
+		git_reference_free(reference);
+	}
+
+	git_reference_iterator_free(iterator);
+	return error == GIT_ITEROVER;
+}
+
+bool GitLibLock::HasObject(const std::string& oid)
+{
+	git_oid id;
+	if (!repository || git_oid_fromstr(&id, oid.c_str()) != GIT_OK)
+		return false;
+
+	git_odb* odb = nullptr;
+	if (git_repository_odb(&odb, repository) != GIT_OK)
+		return false;
+
+	const bool exists = git_odb_exists(odb, &id);
+	git_odb_free(odb);
+	return exists;
+}
+
+bool GitLibLock::IsDescendantOf(const std::string& commit, const std::string& ancestor)
+{
+	git_oid commit_id, ancestor_id;
+	if (!repository || git_oid_fromstr(&commit_id, commit.c_str()) != GIT_OK || git_oid_fromstr(&ancestor_id, ancestor.c_str()) != GIT_OK)
+		return false;
+
+	return git_graph_descendant_of(repository, &commit_id, &ancestor_id) == 1;
+}
+
+// Same check git runs on received objects before moving a ref: every commit, tree and blob reachable
+// from commit but not from ancestor must be present. An empty ancestor checks the whole history.
+bool GitLibLock::IsConnected(const std::string& commit, const std::string& ancestor)
+{
+	git_oid commit_id;
+	if (!repository || git_oid_fromstr(&commit_id, commit.c_str()) != GIT_OK)
+		return false;
+
+	git_odb* odb = nullptr;
+	if (git_repository_odb(&odb, repository) != GIT_OK)
+		return false;
+
+	git_revwalk* walk = nullptr;
+	bool is_connected = git_revwalk_new(&walk, repository) == GIT_OK && git_revwalk_push(walk, &commit_id) == GIT_OK;
+
+	if (is_connected && !ancestor.empty())
+	{
+		git_oid ancestor_id;
+		is_connected = git_oid_fromstr(&ancestor_id, ancestor.c_str()) == GIT_OK && git_revwalk_hide(walk, &ancestor_id) == GIT_OK;
+	}
+
+	// Trees shared between commits are only walked once
+	std::unordered_set<std::string> seen_trees;
+	std::vector<git_oid> trees;
+	char buffer[GIT_OID_SHA1_HEXSIZE + 1];
+
+	git_oid id;
+	int error = GIT_OK;
+	while (is_connected && (error = git_revwalk_next(&id, walk)) == GIT_OK)
+	{
+		git_commit* current = nullptr;
+		if (git_commit_lookup(&current, repository, &id) != GIT_OK)
+		{
+			is_connected = false;
+			break;
+		}
+
+		trees.push_back(*git_commit_tree_id(current));
+		git_commit_free(current);
+
+		while (is_connected && !trees.empty())
+		{
+			const auto tree_id = trees.back();
+			trees.pop_back();
+
+			if (!seen_trees.insert(git_oid_tostr(buffer, sizeof buffer, &tree_id)).second)
+				continue;
+
+			git_tree* tree = nullptr;
+			if (git_tree_lookup(&tree, repository, &tree_id) != GIT_OK)
+			{
+				is_connected = false;
+				break;
+			}
+
+			for (size_t i = 0, count = git_tree_entrycount(tree); i < count && is_connected; ++i)
+			{
+				const auto* entry = git_tree_entry_byindex(tree, i);
+				const auto type = git_tree_entry_type(entry);
+				if (type == GIT_OBJECT_TREE)
+					trees.push_back(*git_tree_entry_id(entry));
+				// Submodule commits live in another repository
+				else if (type == GIT_OBJECT_BLOB)
+					is_connected = git_odb_exists(odb, git_tree_entry_id(entry));
+			}
+
+			git_tree_free(tree);
+		}
+	}
+
+	// Walk ends early on a missing parent
+	if (error != GIT_OK && error != GIT_ITEROVER)
+		is_connected = false;
+
+	if (walk)
+		git_revwalk_free(walk);
+	git_odb_free(odb);
+	return is_connected;
+}
+
+// Fails without touching the reference when it no longer points at expected_oid
+bool GitLibLock::CompareAndSwapReference(const std::string& reference_name, const std::string& expected_oid,
+	const std::string& new_oid, const std::string& log_message)
+{
+	git_oid new_id;
+	if (!repository || git_oid_fromstr(&new_id, new_oid.c_str()) != GIT_OK)
+		return false;
+
+	git_reference* reference = nullptr;
+	int error;
+	if (expected_oid.empty())
+	{
+		error = git_reference_create(&reference, repository, reference_name.c_str(), &new_id, 0, log_message.c_str());
+	}
+	else
+	{
+		git_oid expected_id;
+		if (git_oid_fromstr(&expected_id, expected_oid.c_str()) != GIT_OK)
+			return false;
+
+		error = git_reference_create_matching(&reference, repository, reference_name.c_str(), &new_id, 1, &expected_id, log_message.c_str());
+	}
+
+	if (reference)
+		git_reference_free(reference);
+	return error == GIT_OK;
+}
+
 bool GitLibLock::GetHead()
 {
 	return repository && git_repository_head(&head, repository) == GIT_ERROR_NONE;
@@ -262,3 +997,18 @@ bool GitLibLock::GetCurrentIndex()
 {
 	return repository && git_repository_index(&index, repository) == GIT_ERROR_NONE;
 }
+
+bool GitLibLock::GetUpstreamId(git_oid& upstream_oid)
+{
+	git_reference* upstream = nullptr;
+	if (git_branch_upstream(&upstream, head) == GIT_OK)
+	{
+		const auto result = git_reference_name_to_id(&upstream_oid, repository, git_reference_name(upstream));
+		git_reference_free(upstream);
+		return result == GIT_OK;
+	}
+
+	// Branches without tracking configuration are compared against origin, same as pull does
+	const auto remote_branch = std::string{ "refs/remotes/origin/" } + git_reference_shorthand(head);
+	return git_reference_name_to_id(&upstream_oid, repository, remote_branch.c_str()) == GIT_OK;
+}
@@ -1,12 +1,30 @@
 #pragma once
+#include <atomic>
+#include <filesystem>
 #include <functional>
+#include <map>
 #include <string>
+#include <vector>
 
+#include "Data/Data.h"
 #include "Tasks/PullPrepareTask.h"
 
+class GitLibRuntime;
+
+struct GitFetchSettings
+{
+	// 0 fetches full history
+	int depth = 0;
+	bool download_tags = true;
+	bool update_fetchhead = true;
+	// Empty uses refspecs configured for the remote
+	std::vector<std::string> refspecs;
+};
+
 // Git2 references
 // ReSharper disable CppInconsistentNaming
 struct git_index;
+struct git_oid;
 struct git_reference;
 struct git_remote;
 struct git_repository;
@@ -20,21 +38,44 @@ public:
 	~GitLibLock();
 
 	bool OpenRepo(const std::string_view& path);
+	bool OpenOrCreateBareRepo(const std::string_view& path);
+	bool AddAlternate(const std::string& objects_path);
 	bool LookupRemote(const std::string_view& name);
+	bool GetRemoteUrl(const std::string_view& name, std::string& url);
 	bool ConnectToRemote(const std::string_view& remote_name);
 	bool ConnectToRemote(std::function<int(const char*)>& remote_text_callback,
-		std::function<int(unsigned, unsigned, size_t)>& progress_callback,
+		std::function<int(const TransferStats&)>& progress_callback,
 		const std::string_view& remote_name);
 	bool Fetch(std::function<int(const char*)>& remote_text_callback,
-		std::function<int(unsigned, unsigned, size_t)>& progress_callback,
-		const std::string_view& remote_name);
+		std::function<int(const TransferStats&)>& progress_callback,
+		const std::string_view& remote_name, const GitFetchSettings& settings);
+	bool FetchUrl(std::function<int(const char*)>& remote_text_callback,
+		std::function<int(const TransferStats&)>& progress_callback,
+		const std::string& url, const GitFetchSettings& settings);
 	bool Pull(const std::string_view& remote_name);
 
 	bool FullCheckoutToIndex();
 
 	bool GetBranchData(bool& is_detached, std::string& branch_or_sha);
-	bool GetFileModificationStats(const bool& interrupt, size_t& added, size_t& modified, size_t deleted);
+	// Name of the remote branch that branch.<branch>.merge points at, empty without an upstream
+	bool GetUpstreamBranch(const std::string& branch, std::string& upstream_branch);
+	bool GetFileModificationStats(const std::atomic<bool>& interrupt, size_t& added, size_t& modified, size_t& deleted);
+	bool GetAheadBehind(size_t walk_limit, bool& has_upstream, size_t& ahead, size_t& behind, bool& is_capped);
 	bool HasIncoming();
+	bool HasAdvertisedIncoming(const std::string_view& remote_name, bool& has_incoming);
+
+	// Object ids are passed as hex strings, an empty id stands for a missing reference
+	bool GetObjectDirectories(std::vector<std::filesystem::path>& directories);
+	bool GetReferenceTarget(const std::string& reference_name, std::string& oid);
+	// Direct references matching the glob, by name
+	bool ListReferences(const std::string& glob, std::map<std::string, std::string>& targets);
+	bool HasObject(const std::string& oid);
+	bool IsDescendantOf(const std::string& commit, const std::string& ancestor);
+	bool IsConnected(const std::string& commit, const std::string& ancestor);
+	bool CompareAndSwapReference(const std::string& reference_name, const std::string& expected_oid,
+		const std::string& new_oid, const std::string& log_message);
+	bool UpdatePresentAdvertised(const std::string_view& remote_name, const GitFetchSettings& settings,
+		std::vector<std::string>& missing_refspecs);
 
 	GitLibLock(const GitLibLock& other) = delete;
 	GitLibLock(GitLibLock&& other) noexcept = delete;
@@ -42,6 +83,8 @@ public:
 	GitLibLock& operator=(GitLibLock&& other) noexcept = delete;
 
 private:
+	GitLibRuntime& runtime;
+
 	git_repository* repository = nullptr;
 	git_reference* head = nullptr;
 	git_index* index = nullptr;
@@ -50,5 +93,6 @@ private:
 
 	bool GetHead();
 	bool GetCurrentIndex();
+	bool GetUpstreamId(git_oid& upstream_oid);
 };
 
@@ -0,0 +1,215 @@
+#include "GitLibRuntime.h"
+
+#include <filesystem>
+#include <ranges>
+#include <git2.h>
+#include <Windows.h>
+#include <Psapi.h>
+
+#include "Config.h"
+
+namespace
+{
+	// Handles unused for this long are closed on the next pool operation
+	constexpr std::chrono::seconds IdleTimeout{ 30 };
+
+	constexpr size_t MiB = 1024 * 1024;
+	constexpr size_t MinimalWindowSize = MiB;
+	constexpr size_t OpenFilesPerRepository = 8;
+
+	// Biggest commits and tags are small, trees scale with the budget share of a repository
+	constexpr size_t CommitCacheLimit = 4096;
+	constexpr size_t MinimalTreeCacheLimit = 1024;
+	constexpr size_t MaximalTreeCacheLimit = 16 * 1024;
+}
+
+GitLibRuntime& GitLibRuntime::Instance()
+{
+	static GitLibRuntime runtime;
+	return runtime;
+}
+
+GitLibRuntime::GitLibRuntime()
+{
+	git_libgit2_init();
+
+	// Fetching with a partial clone filter turns this extension on, libgit2 refuses unknown ones
+	const char* extensions[] = { "partialclone" };
+	git_libgit2_opts(GIT_OPT_SET_EXTENSIONS, extensions, std::size(extensions));
+}
+
+GitLibRuntime::~GitLibRuntime()
+{
+	for (auto& entry : pool | std::views::values)
+	{
+		for (const auto& handle : entry.handles)
+			git_repository_free(handle.repository);
+
+		if (entry.odb)
+			git_odb_free(entry.odb);
+	}
+	pool.clear();
+
+	git_libgit2_shutdown();
+}
+
+git_repository* GitLibRuntime::LeaseRepository(const std::string_view& path)
+{
+	const auto key = GetPoolKey(path);
+
+	{
+		std::lock_guard lock(mutex);
+		EvictExpired(Clock::now());
+
+		if (const auto it = pool.find(key); it != pool.end())
+		{
+			for (auto& handle : it->second.handles)
+			{
+				if (!handle.is_leased)
+				{
+					handle.is_leased = true;
+					return handle.repository;
+				}
+			}
+		}
+	}
+
+	// Opening reads config and refs from disk, don't hold the pool while doing it
+	git_repository* repository = nullptr;
+	if (git_repository_open_ext(&repository, std::string{ path }.c_str(), GIT_REPOSITORY_OPEN_NO_SEARCH, "") != GIT_ERROR_NONE)
+		return nullptr;
+
+	std::lock_guard lock(mutex);
+	auto& entry = pool[key];
+
+	if (entry.odb)
+		git_repository_set_odb(repository, entry.odb);
+	else git_repository_odb(&entry.odb, repository);
+
+	entry.handles.push_back({ repository, true, {} });
+	return repository;
+}
+
+void GitLibRuntime::ReleaseRepository(git_repository* repository)
+{
+	if (!repository)
+		return;
+
+	std::lock_guard lock(mutex);
+	const auto now = Clock::now();
+
+	for (auto& entry : pool | std::views::values)
+	{
+		for (auto& handle : entry.handles)
+		{
+			if (handle.repository == repository)
+			{
+				handle.is_leased = false;
+				handle.released_at = now;
+				return;
+			}
+		}
+	}
+}
+
+void GitLibRuntime::EvictIdle(const std::string_view& path)
+{
+	std::lock_guard lock(mutex);
+
+	if (const auto it = pool.find(GetPoolKey(path)); it != pool.end())
+		EvictIdle(it->second, Clock::time_point::max());
+}
+
+void GitLibRuntime::EvictAllIdle()
+{
+	std::lock_guard lock(mutex);
+
+	for (auto& entry : pool | std::views::values)
+		EvictIdle(entry, Clock::time_point::max());
+}
+
+void GitLibRuntime::ApplyMemoryBudget(const MemoryBudget& budget, size_t active_repositories)
+{
+	active_repositories = std::max<size_t>(active_repositories, 1);
+	const size_t limit = budget.limit_mb * MiB;
+
+	// Half of the budget for mapped pack windows, a quarter for object caches,
+	// the rest is left for indexes, status lists and libgit2 bookkeeping
+	const size_t mapped_limit = limit / 2;
+	const size_t cache_limit = limit / 4;
+
+	size_t default_window_size = 0;
+	git_libgit2_opts(GIT_OPT_GET_MWINDOW_SIZE, &default_window_size);
+	const size_t window_size = std::clamp(mapped_limit / active_repositories, MinimalWindowSize,
+		std::max<size_t>(default_window_size, MinimalWindowSize));
+
+	const size_t open_files = budget.open_files ? budget.open_files : active_repositories * OpenFilesPerRepository;
+
+	const size_t tree_limit = std::clamp(cache_limit / active_repositories / 1024,
+		MinimalTreeCacheLimit, MaximalTreeCacheLimit);
+
+	git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, mapped_limit);
+	git_libgit2_opts(GIT_OPT_SET_MWINDOW_SIZE, window_size);
+	git_libgit2_opts(GIT_OPT_SET_MWINDOW_FILE_LIMIT, open_files);
+	git_libgit2_opts(GIT_OPT_SET_CACHE_MAX_SIZE, static_cast<ptrdiff_t>(cache_limit));
+	git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_COMMIT, CommitCacheLimit);
+	git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_TAG, CommitCacheLimit);
+	git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_TREE, tree_limit);
+	git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_BLOB, static_cast<size_t>(0));
+}
+
+void GitLibRuntime::SampleMemoryUsage()
+{
+	// libgit2 reports ssize_t values
+	ptrdiff_t current = 0, allowed = 0;
+	if (git_libgit2_opts(GIT_OPT_GET_CACHED_MEMORY, &current, &allowed) != GIT_OK)
+		return;
+
+	peak_cached_memory = std::max<int64_t>(peak_cached_memory, current);
+	allowed_cached_memory = allowed;
+}
+
+void GitLibRuntime::ReportMemoryUsage(std::ostream& output) const
+{
+	size_t mapped_limit = 0;
+	git_libgit2_opts(GIT_OPT_GET_MWINDOW_MAPPED_LIMIT, &mapped_limit);
+
+	output << "Memory: peak object cache " << peak_cached_memory / MiB << " MiB"
+		<< " of " << allowed_cached_memory / MiB << " MiB"
+		<< ", mapped pack limit " << mapped_limit / MiB << " MiB";
+
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		output << ", peak working set " << counters.PeakWorkingSetSize / MiB << " MiB";
+
+	output << std::endl;
+}
+
+std::string GitLibRuntime::GetPoolKey(const std::string_view& path)
+{
+	return std::filesystem::path{ path }.lexically_normal().generic_string();
+}
+
+void GitLibRuntime::EvictExpired(const Clock::time_point now)
+{
+	for (auto& entry : pool | std::views::values)
+		EvictIdle(entry, now - IdleTimeout);
+}
+
+void GitLibRuntime::EvictIdle(PoolEntry& entry, const Clock::time_point older_than)
+{
+	std::erase_if(entry.handles, [older_than](const PooledHandle& handle)
+	{
+		if (handle.is_leased || handle.released_at > older_than)
+			return false;
+
+		git_repository_free(handle.repository);
+		return true;
+	});
+
+	if (entry.handles.empty() && entry.odb)
+	{
+		git_odb_free(entry.odb);
+		entry.odb = nullptr;
+	}
+}
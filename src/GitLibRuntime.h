@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Git2 references
+// ReSharper disable CppInconsistentNaming
+struct git_odb;
+struct git_repository;
+// ReSharper restore CppInconsistentNaming
+
+struct MemoryBudget;
+
+// Keeps libgit2 initialized once per process and pools opened repositories by path.
+// A handle is leased to one task at a time; tasks that follow each other on the same
+// repository reuse it together with its odb and refdb caches.
+class GitLibRuntime
+{
+public:
+	static GitLibRuntime& Instance();
+
+	git_repository* LeaseRepository(const std::string_view& path);
+	void ReleaseRepository(git_repository* repository);
+
+	// Closes idle handles of a repository before a git process works on it, so that
+	// mapped pack files don't block repacks on Windows
+	void EvictIdle(const std::string_view& path);
+	void EvictAllIdle();
+
+	// Splits the budget between mapped pack windows and object caches of active_repositories
+	void ApplyMemoryBudget(const MemoryBudget& budget, size_t active_repositories);
+	void SampleMemoryUsage();
+	void ReportMemoryUsage(std::ostream& output) const;
+
+	GitLibRuntime(const GitLibRuntime& other) = delete;
+	GitLibRuntime(GitLibRuntime&& other) noexcept = delete;
+	GitLibRuntime& operator=(const GitLibRuntime& other) = delete;
+	GitLibRuntime& operator=(GitLibRuntime&& other) noexcept = delete;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct PooledHandle
+	{
+		git_repository* repository = nullptr;
+		bool is_leased = false;
+		Clock::time_point released_at;
+	};
+
+	struct PoolEntry
+	{
+		// Shared by every handle opened on the same path
+		git_odb* odb = nullptr;
+		std::vector<PooledHandle> handles;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<std::string, PoolEntry> pool;
+
+	int64_t peak_cached_memory = 0;
+	int64_t allowed_cached_memory = 0;
+
+	GitLibRuntime();
+	~GitLibRuntime();
+
+	static std::string GetPoolKey(const std::string_view& path);
+	void EvictExpired(Clock::time_point now);
+	void EvictIdle(PoolEntry& entry, Clock::time_point older_than);
+};
@@ -0,0 +1,108 @@
+#include "Jobserver.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <Windows.h>
+
+Jobserver::Lease::Lease(Jobserver* jobserver, const size_t tokens) :
+	jobserver(jobserver),
+	tokens(tokens)
+{
+}
+
+Jobserver::Lease::~Lease()
+{
+	if (jobserver)
+		jobserver->Release(tokens);
+}
+
+Jobserver::Lease::Lease(Lease&& other) noexcept :
+	jobserver(std::exchange(other.jobserver, nullptr)),
+	tokens(other.tokens)
+{
+}
+
+Jobserver::Lease& Jobserver::Lease::operator=(Lease&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (jobserver)
+			jobserver->Release(tokens);
+
+		jobserver = std::exchange(other.jobserver, nullptr);
+		tokens = other.tokens;
+	}
+	return *this;
+}
+
+Jobserver::~Jobserver()
+{
+	if (semaphore)
+		CloseHandle(semaphore);
+}
+
+bool Jobserver::Start(const size_t job_count, std::string& error)
+{
+	if (semaphore)
+		return true;
+
+	std::ostringstream name;
+	name << "mgit_jobserver_" << GetCurrentProcessId();
+
+	const auto tokens = static_cast<LONG>(job_count);
+	semaphore = CreateSemaphoreA(nullptr, tokens, tokens, name.str().c_str());
+	if (!semaphore)
+	{
+		std::ostringstream str;
+		str << "Failed to create jobserver semaphore: " << GetLastError();
+		error = str.str();
+		return false;
+	}
+
+	jobs = job_count;
+
+	// Flags from the caller are kept, a -j given on a step's own command line makes make leave the jobserver
+	std::ostringstream flags;
+	char existing[4096];
+	const DWORD length = GetEnvironmentVariableA("MAKEFLAGS", existing, sizeof existing);
+	if (length > 0 && length < sizeof existing)
+		flags << existing << ' ';
+	flags << "-j" << jobs << " --jobserver-auth=" << name.str();
+
+	SetEnvironmentVariableA("MAKEFLAGS", flags.str().c_str());
+	return true;
+}
+
+bool Jobserver::Acquire(const size_t tokens, const std::atomic<bool>& stop, Lease& lease)
+{
+	if (!semaphore)
+		return true;
+
+	const auto needed = std::clamp<size_t>(tokens, 1, jobs);
+
+	std::lock_guard lock(acquire_mutex);
+
+	size_t taken = 0;
+	while (taken < needed)
+	{
+		if (stop)
+		{
+			Release(taken);
+			return false;
+		}
+
+		// Wait in slices, stop flag can't be waited on together with the semaphore
+		if (WaitForSingleObject(semaphore, 100) == WAIT_OBJECT_0)
+			++taken;
+	}
+
+	lease = Lease{ this, taken };
+	return true;
+}
+
+void Jobserver::Release(const size_t tokens) const
+{
+	if (tokens > 0)
+		ReleaseSemaphore(semaphore, static_cast<LONG>(tokens), nullptr);
+}
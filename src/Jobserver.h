@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+
+// GNU make jobserver shared by every build step. make 4.4 and ninja 1.13 on Windows take their tokens
+// from a named semaphore passed in MAKEFLAGS, mgit takes one token per unit of step weight, which stands
+// for the implicit token of the make or ninja the step starts.
+class Jobserver
+{
+public:
+	class Lease
+	{
+	public:
+		Lease() = default;
+		Lease(Jobserver* jobserver, size_t tokens);
+		~Lease();
+
+		Lease(const Lease& other) = delete;
+		Lease(Lease&& other) noexcept;
+		Lease& operator=(const Lease& other) = delete;
+		Lease& operator=(Lease&& other) noexcept;
+
+	private:
+		Jobserver* jobserver = nullptr;
+		size_t tokens = 0;
+	};
+
+	Jobserver() = default;
+	~Jobserver();
+
+	Jobserver(const Jobserver& other) = delete;
+	Jobserver(Jobserver&& other) noexcept = delete;
+	Jobserver& operator=(const Jobserver& other) = delete;
+	Jobserver& operator=(Jobserver&& other) noexcept = delete;
+
+	// Creates the semaphore with jobs tokens and exports it to every process started afterward
+	bool Start(size_t jobs, std::string& error);
+
+	// Blocks until tokens are taken, false when stop was raised meanwhile. Requests above the job count take every token.
+	bool Acquire(size_t tokens, const std::atomic<bool>& stop, Lease& lease);
+
+private:
+	// HANDLE of the semaphore, nullptr while stopped
+	void* semaphore = nullptr;
+	size_t jobs = 0;
+	// Only one step collects tokens at a time, so that two steps can't each hold part of what the other needs
+	std::mutex acquire_mutex;
+
+	void Release(size_t tokens) const;
+};
@@ -1,9 +1,13 @@
 #include "MultiController.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
 #include "Config.h"
+#include "GitLibRuntime.h"
+#include "Prewarm.h"
+#include "ProcessLauncher.h"
 #include "RepoOrchestrator.h"
 #include "Data/Data.h"
 #include "Displays/PipelineDisplay.h"
@@ -12,6 +16,19 @@
 
 // ReSharper disable once StringLiteralTypo
 constexpr auto ConfigFilePathAppendix = R"(\.config\mgit\repos.json)";
+// ReSharper disable once StringLiteralTypo
+constexpr auto StateFilePathAppendix = R"(\.config\mgit\state.json)";
+
+namespace
+{
+	std::string GetUserFilePath(const char* appendix)
+	{
+		// ReSharper disable once StringLiteralTypo
+		// ReSharper disable once CppDeprecatedEntity
+		const auto user_profile = getenv("USERPROFILE");
+		return std::string{user_profile} + appendix;
+	}
+}
 
 namespace OutputControl
 {
@@ -31,12 +48,9 @@ namespace OutputControl
 	}
 }
 
-bool MultiController::LoadConfig(std::ostream& error_stream)
+bool MultiController::LoadConfig(std::ostream& error_stream, const std::vector<std::string>& args)
 {
-	// ReSharper disable once StringLiteralTypo
-	// ReSharper disable once CppDeprecatedEntity
-	const auto user_profile = getenv("USERPROFILE");
-	const auto config_file_path = std::string{user_profile} + ConfigFilePathAppendix;
+	const auto config_file_path = GetUserFilePath(ConfigFilePathAppendix);
 
 	std::ifstream f{config_file_path};
 	if (!f.is_open())
@@ -50,19 +64,39 @@ bool MultiController::LoadConfig(std::ostream& error_stream)
 	f.close();
 
 	config = data.get<Config>();
+	config.ApplyArguments(args);
+
+	if (!config.Validate(error_stream))
+		return false;
 
-	return config.Validate();
+	run_context.bandwidth_limiter.SetLimit(config.network.bandwidth_limit_kb * 1024);
+	run_context.host_limiter.SetLimit(config.network.connections_per_host);
+	run_context.device_queues.SetLimits(config.devices);
+	run_context.network_pool.SetCapacity(config.pools.network);
+	run_context.disk_pool.SetCapacity(config.pools.disk);
+	run_context.cpu_pool.SetCapacity(config.pools.cpu != 0 ? config.pools.cpu : std::max<size_t>(1, std::thread::hardware_concurrency()));
+	if (config.concurrency.adaptive)
+	{
+		// Tasks beyond the pool capacity never start, a wider window could never fill
+		run_context.network_concurrency.Configure(config.concurrency.network.ClampedTo(config.pools.network));
+		run_context.disk_concurrency.Configure(config.concurrency.disk.ClampedTo(config.pools.disk));
+	}
+
+	LoadState();
+	return true;
 }
 
-int MultiController::DisplayStatus()
+int MultiController::DisplayStatus(const bool quiet)
 {
-	std::function<void(const RepoConfig&, size_t)> register_function = [&register_function, this
+	std::function<void(const RepoConfig&, size_t)> register_function = [&register_function, quiet, this
 		](const RepoConfig& repo_config, size_t sub_level)
 	{
 		if (!repo_config.hidden)
 		{
-			auto orchestrator = std::make_unique<RepoOrchestrator>(repo_config, sub_level);
-			orchestrator->PlanStatusJob();
+			auto orchestrator = std::make_unique<RepoOrchestrator>(repo_config, sub_level, run_context);
+			if (quiet)
+				orchestrator->PlanQuietStatusJob();
+			else orchestrator->PlanStatusJob();
 			tasks.Emplace(repo_config.repo_name, std::move(orchestrator));
 
 			for (const auto& sub_repo : repo_config.sub_repos)
@@ -73,21 +107,40 @@ int MultiController::DisplayStatus()
 	for (const auto& repo_config : config.repositories)
 		register_function(repo_config, 0);
 
-	StatusDisplay display(tasks);
+	Prewarm();
+	LoadStatusHistory();
+
+	int result;
+	if (quiet)
+	{
+		result = RunQuietTask();
+	}
+	else
+	{
+		StatusDisplay display(tasks);
+		result = RunTask(display);
+	}
+
+	RecordStatusHistory();
+	SaveState();
 
-	const int result = RunTask(display);
 	tasks.Clear();
 	return result;
 }
 
-int MultiController::Pull()
+int MultiController::Pull(const bool check_only)
 {
+	if (!check_only)
+		SyncObjectPool();
+
 	{ // check repositories
-		std::function<void(const std::shared_ptr<RepoOrchestrator>&, const RepoConfig&, size_t level)> register_prepare = [&register_prepare, this]
+		std::function<void(const std::shared_ptr<RepoOrchestrator>&, const RepoConfig&, size_t level)> register_prepare = [&register_prepare, check_only, this]
 		(const std::shared_ptr<RepoOrchestrator>& parent, const RepoConfig& repo_config, const size_t level)
 		{
-			const auto orchestrator = std::make_shared<RepoOrchestrator>(repo_config, level);
-			orchestrator->PlanPullPrepareJob();
+			const auto orchestrator = std::make_shared<RepoOrchestrator>(repo_config, level, run_context);
+			if (check_only)
+				orchestrator->PlanPullCheckJob();
+			else orchestrator->PlanPullPrepareJob();
 
 			if (parent)
 				parent->RegisterChild(orchestrator);
@@ -101,9 +154,15 @@ int MultiController::Pull()
 		for (const auto& repo_config : config.repositories)
 			register_prepare(nullptr, repo_config, 0);
 
+		Prewarm();
+		LoadFetchHistory();
+
 		PipelineDisplay prepare_display(tasks);
 		const int result = RunTask(prepare_display);
 
+		RecordFetchHistory();
+		SaveState();
+
 		if (result != 0)
 		{
 			tasks.Clear();
@@ -200,7 +259,16 @@ int MultiController::Pull()
 			for (const auto& repo : complicated_pull)
 				std::cout << '\t' << repo->GetConfig().repo_name << std::endl;
 			std::cout << std::endl;
+		}
+
+		if (check_only)
+		{
+			tasks.Clear();
+			return 0;
+		}
 
+		if(!complicated_pull.empty())
+		{
 			std::cout << "For problematic repositories, MGit will checkout all the changes and reset the repositories. Type 'Y' to accept. Make sure nothing important is getting removed." << std::endl
 				<< "Do you accept?    ";
 
@@ -242,6 +310,32 @@ int MultiController::Pull()
 	}
 }
 
+int MultiController::Prefetch()
+{
+	EnterBackgroundMode();
+	SyncObjectPool();
+
+	std::function<void(const RepoConfig&, size_t)> register_function = [&register_function, this
+		](const RepoConfig& repo_config, size_t sub_level)
+	{
+		const auto orchestrator = std::make_shared<RepoOrchestrator>(repo_config, sub_level, run_context);
+		orchestrator->PlanPrefetchJob();
+		tasks.Emplace(repo_config.repo_name, orchestrator);
+
+		for (const auto& sub_repo : repo_config.sub_repos)
+			register_function(sub_repo, sub_level + 1);
+	};
+
+	for (const auto& repo_config : config.repositories)
+		register_function(repo_config, 0);
+
+	PipelineDisplay display(tasks);
+
+	const int result = RunTask(display);
+	tasks.Clear();
+	return result;
+}
+
 int MultiController::Build()
 {
 	// Build tasks
@@ -251,7 +345,7 @@ int MultiController::Build()
 		{
 			auto& repo_data = tasks[repo_config.repo_name];
 			if(!repo_data)
-				repo_data = std::make_shared<RepoOrchestrator>(repo_config, 0);
+				repo_data = std::make_shared<RepoOrchestrator>(repo_config, 0, run_context);
 			repo_data->PlanBuildJobs();
 		}
 	}
@@ -277,6 +371,14 @@ int MultiController::Build()
 		}
 	}
 
+	if (config.jobs != 0)
+	{
+		std::string error;
+		if (run_context.jobserver.Start(config.jobs, error))
+			run_context.cpu_pool.SetCapacity(config.jobs);
+		else std::cout << error << std::endl;
+	}
+
 	PipelineDisplay display(tasks);
 
 	const auto result = RunTask(display);
@@ -297,6 +399,110 @@ const RepoConfig* MultiController::GetRepo(const std::string_view& repo_name) co
 	return nullptr;
 }
 
+void MultiController::LoadState()
+{
+	std::ifstream f{GetUserFilePath(StateFilePathAppendix)};
+	if (!f.is_open())
+		return;
+
+	const nlohmann::json data = nlohmann::json::parse(f, nullptr, false);
+	if (data.is_discarded())
+		return;
+
+	state = data.get<State>();
+}
+
+void MultiController::SaveState() const
+{
+	std::ofstream f{GetUserFilePath(StateFilePathAppendix)};
+	if (!f.is_open())
+		return;
+
+	const nlohmann::json data = state;
+	f << data.dump(1, '\t');
+}
+
+void MultiController::LoadStatusHistory()
+{
+	for (const auto& task : tasks)
+	{
+		const auto& orchestrator = task.second;
+		const auto it = state.repositories.find(orchestrator->GetConfig().path);
+		if (it != state.repositories.end())
+			orchestrator->GetRepositoryInfo().previous_status_scan_ms = it->second.status_scan_ms;
+	}
+}
+
+void MultiController::RecordStatusHistory()
+{
+	for (const auto& task : tasks)
+	{
+		const auto& orchestrator = task.second;
+		const auto& repo_info = orchestrator->GetRepositoryInfo();
+		auto& repo_state = state.repositories[orchestrator->GetConfig().path];
+
+		// Cancelled scans tell nothing about the repository, keep the old record
+		if (repo_info.is_dirty)
+			repo_state.was_dirty = true;
+		else if (orchestrator->IsComplete())
+			repo_state.was_dirty = false;
+
+		if (repo_info.status_scan_ms >= 0)
+			repo_state.status_scan_ms = repo_info.status_scan_ms;
+	}
+}
+
+void MultiController::LoadFetchHistory()
+{
+	for (const auto& task : tasks)
+	{
+		const auto& orchestrator = task.second;
+		const auto it = state.repositories.find(orchestrator->GetConfig().path);
+		if (it == state.repositories.end())
+			continue;
+
+		auto& last_fetch_times = orchestrator->GetRepositoryInfo().last_fetch_times;
+		auto& connect_times = orchestrator->GetRepositoryInfo().connect_times;
+		for (const auto& [remote_name, remote_state] : it->second.remotes)
+		{
+			last_fetch_times[remote_name] = remote_state.last_fetch;
+			if (remote_state.connect_ms >= 0)
+				connect_times[remote_name] = remote_state.connect_ms;
+		}
+	}
+}
+
+void MultiController::RecordFetchHistory()
+{
+	for (const auto& task : tasks)
+	{
+		const auto& orchestrator = task.second;
+		auto& repo_state = state.repositories[orchestrator->GetConfig().path];
+
+		for (const auto& [remote_name, last_fetch] : orchestrator->GetRepositoryInfo().last_fetch_times)
+			repo_state.remotes[remote_name].last_fetch = last_fetch;
+
+		// Smoothed so that a single slow handshake doesn't flip the remote order
+		for (const auto& [remote_name, connect_ms] : orchestrator->GetRepositoryInfo().connect_times)
+		{
+			auto& stored_ms = repo_state.remotes[remote_name].connect_ms;
+			stored_ms = stored_ms < 0 ? connect_ms : (stored_ms * 3 + connect_ms) / 4;
+		}
+	}
+}
+
+void MultiController::Prewarm() const
+{
+	if (!config.prewarm)
+		return;
+
+	std::vector<const RepoConfig*> repositories;
+	for (const auto& task : tasks)
+		repositories.push_back(&task.second->GetConfig());
+
+	PrewarmRepositories(repositories);
+}
+
 bool MultiController::ShouldExit() const
 {
 	bool is_all_complete = true;
@@ -320,9 +526,31 @@ bool MultiController::HasError() const
 	return false;
 }
 
+// Repositories that can hold libgit2 memory at once, the budget is shared among them only.
+// Network and disk tasks both open repositories, the less limited class decides.
+size_t MultiController::GetConcurrentRepositories() const
+{
+	const auto get_limit = [this](const size_t pool_capacity, const ConcurrencyLimits& limits)
+	{
+		size_t limit = tasks.size();
+		if (pool_capacity != 0)
+			limit = std::min<size_t>(limit, pool_capacity);
+		if (config.concurrency.adaptive)
+			limit = std::min<size_t>(limit, limits.max);
+		return limit;
+	};
+
+	return std::max<size_t>(get_limit(config.pools.network, config.concurrency.network), get_limit(config.pools.disk, config.concurrency.disk));
+}
+
 // ReSharper disable once CppMemberFunctionMayBeConst
 int MultiController::RunTask(Display& display)
 {
+	auto& runtime = GitLibRuntime::Instance();
+	const bool has_memory_budget = config.memory_budget.IsEnabled();
+	if (has_memory_budget)
+		runtime.ApplyMemoryBudget(config.memory_budget, GetConcurrentRepositories());
+
 	for (const auto& task : tasks)
 		task.second->Launch();
 
@@ -347,10 +575,118 @@ int MultiController::RunTask(Display& display)
 
 		std::cout << temp_buffer.str();
 
+		if (has_memory_budget)
+			runtime.SampleMemoryUsage();
+
 		if (!is_finished)
 			std::this_thread::sleep_for(std::chrono::milliseconds{100});
 	}
 	while (!is_finished);
 
+	if (has_memory_budget)
+		runtime.ReportMemoryUsage(std::cout);
+
+	run_context.network_concurrency.Report(std::cout);
+	run_context.disk_concurrency.Report(std::cout);
+
 	return HasError() ? 1 : 0;
 }
+
+int MultiController::RunQuietTask()
+{
+	// Repositories that were dirty last time are the most likely to be dirty again,
+	// cheap scans come next so that a clean answer also arrives as early as possible
+	std::vector<std::shared_ptr<RepoOrchestrator>> ordered;
+	for (const auto& task : tasks)
+		ordered.push_back(task.second);
+
+	const auto get_state = [this](const std::shared_ptr<RepoOrchestrator>& orchestrator)
+	{
+		const auto it = state.repositories.find(orchestrator->GetConfig().path);
+		return it != state.repositories.end() ? it->second : RepoState{};
+	};
+
+	std::ranges::stable_sort(ordered, [&get_state](const auto& lhs, const auto& rhs)
+	{
+		const auto lhs_state = get_state(lhs);
+		const auto rhs_state = get_state(rhs);
+
+		if (lhs_state.was_dirty != rhs_state.was_dirty)
+			return lhs_state.was_dirty;
+		return std::max<int64_t>(lhs_state.status_scan_ms, 0) < std::max<int64_t>(rhs_state.status_scan_ms, 0);
+	});
+
+	if (config.memory_budget.IsEnabled())
+		GitLibRuntime::Instance().ApplyMemoryBudget(config.memory_budget, GetConcurrentRepositories());
+
+	for (const auto& orchestrator : ordered)
+		orchestrator->Launch();
+
+	int result = 0;
+	bool is_finished = false;
+
+	while (!is_finished)
+	{
+		is_finished = true;
+
+		for (const auto& orchestrator : ordered)
+		{
+			if (orchestrator->GetRepositoryInfo().is_dirty || orchestrator->HasError())
+			{
+				result = 1;
+				break;
+			}
+
+			if (!orchestrator->IsComplete())
+				is_finished = false;
+		}
+
+		if (result != 0)
+			break;
+
+		if (!is_finished)
+			std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	}
+
+	// Signal every task first, so that none of them keeps scanning while others are joined
+	for (const auto& orchestrator : ordered)
+		orchestrator->RequestStop();
+	for (const auto& orchestrator : ordered)
+		orchestrator->Stop();
+
+	return result;
+}
+
+// Failures are reported but don't stop the run, repositories then fetch everything themselves
+void MultiController::SyncObjectPool()
+{
+	if (config.object_pool.empty())
+		return;
+
+	std::vector<const RepoConfig*> repositories;
+	std::function<void(const RepoConfig&)> collect = [&collect, &repositories](const RepoConfig& repo_config)
+	{
+		if (repo_config.use_object_pool)
+			repositories.push_back(&repo_config);
+
+		for (const auto& sub_repo : repo_config.sub_repos)
+			collect(sub_repo);
+	};
+
+	for (const auto& repo_config : config.repositories)
+		collect(repo_config);
+
+	if (repositories.empty())
+		return;
+
+	object_pool_config.path = config.object_pool;
+	object_pool_config.repo_name = "object pool";
+
+	const auto orchestrator = std::make_shared<RepoOrchestrator>(object_pool_config, 0, run_context);
+	orchestrator->PlanObjectPoolJob(repositories);
+	tasks.Emplace(object_pool_config.repo_name, orchestrator);
+
+	PipelineDisplay display(tasks);
+	RunTask(display);
+	tasks.Clear();
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "Config.h"
+#include "RunContext.h"
+#include "State.h"
 #include "Tasks/Task.h"
 #include "OrderedMap.h"
 
@@ -11,19 +13,34 @@ using MultiControllerTasks = OrderedMap<std::string, std::shared_ptr<RepoOrchest
 class MultiController
 {
 public:
-    bool LoadConfig(std::ostream& error_stream);
+    bool LoadConfig(std::ostream& error_stream, const std::vector<std::string>& args = {});
 
-    int DisplayStatus();
-    int Pull();
+    int DisplayStatus(bool quiet);
+    int Pull(bool check_only);
+    int Prefetch();
     int Build();
 
     const RepoConfig* GetRepo(const std::string_view& repo_name) const;
 
 private:
     Config config;
+    State state;
     MultiControllerTasks tasks;
+    RunContext run_context;
+    RepoConfig object_pool_config;
+
+    void LoadState();
+    void SaveState() const;
+    void LoadStatusHistory();
+    void RecordStatusHistory();
+    void LoadFetchHistory();
+    void RecordFetchHistory();
+    void Prewarm() const;
+    void SyncObjectPool();
 
     bool ShouldExit() const;
     bool HasError() const;
+    size_t GetConcurrentRepositories() const;
     int RunTask(Display& display);
+    int RunQuietTask();
 };
@@ -0,0 +1,162 @@
+#include "NetworkLimits.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+void BandwidthLimiter::SetLimit(const size_t bytes_per_second)
+{
+	std::lock_guard lock(mutex);
+	limit = bytes_per_second;
+	tokens = static_cast<double>(bytes_per_second);
+	refilled_at = Clock::now();
+}
+
+size_t BandwidthLimiter::GetLimit() const
+{
+	return limit;
+}
+
+bool BandwidthLimiter::Acquire(const size_t bytes, const std::atomic<bool>& stop)
+{
+	if (limit == 0)
+		return true;
+
+	std::chrono::duration<double> debt{ 0 };
+	{
+		std::lock_guard lock(mutex);
+		const auto now = Clock::now();
+		const auto rate = static_cast<double>(limit.load());
+
+		tokens = std::min<double>(rate, tokens + std::chrono::duration<double>(now - refilled_at).count() * rate);
+		refilled_at = now;
+		tokens -= static_cast<double>(bytes);
+
+		if (tokens < 0)
+			debt = std::chrono::duration<double>(-tokens / rate);
+	}
+
+	// Sleep in slices so that a stop request isn't held up by a long debt
+	const auto wake_at = Clock::now() + std::chrono::duration_cast<Clock::duration>(debt);
+	while (Clock::now() < wake_at)
+	{
+		if (stop)
+			return false;
+
+		std::this_thread::sleep_for(std::min<Clock::duration>(wake_at - Clock::now(), std::chrono::milliseconds{ 50 }));
+	}
+
+	return !stop;
+}
+
+HostConnectionLimiter::Lease::Lease(HostConnectionLimiter* limiter, std::string host) :
+	limiter(limiter),
+	host(std::move(host))
+{
+}
+
+HostConnectionLimiter::Lease::~Lease()
+{
+	if (limiter)
+		limiter->Release(host);
+}
+
+HostConnectionLimiter::Lease::Lease(Lease&& other) noexcept :
+	limiter(std::exchange(other.limiter, nullptr)),
+	host(std::move(other.host))
+{
+}
+
+HostConnectionLimiter::Lease& HostConnectionLimiter::Lease::operator=(Lease&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (limiter)
+			limiter->Release(host);
+
+		limiter = std::exchange(other.limiter, nullptr);
+		host = std::move(other.host);
+	}
+
+	return *this;
+}
+
+void HostConnectionLimiter::SetLimit(const size_t connections_per_host)
+{
+	std::lock_guard lock(mutex);
+	limit = connections_per_host;
+}
+
+bool HostConnectionLimiter::Acquire(const std::string& url, const std::atomic<bool>& stop, Lease& lease)
+{
+	const auto host = GetHost(url);
+
+	std::unique_lock lock(mutex);
+	if (limit == 0 || host.empty())
+		return true;
+
+	while (connections[host] >= limit)
+	{
+		if (stop)
+			return false;
+
+		// Stop flag isn't tied to the condition, check it periodically
+		condition.wait_for(lock, std::chrono::milliseconds{ 100 });
+	}
+
+	++connections[host];
+	lease = Lease{ this, host };
+	return true;
+}
+
+// "https://user@host:443/path", "ssh://host/path" and "git@host:path" all give "host",
+// local paths give an empty host
+std::string HostConnectionLimiter::GetHost(const std::string& url)
+{
+	std::string_view rest = url;
+
+	if (const auto scheme_end = rest.find("://"); scheme_end != std::string_view::npos)
+	{
+		if (rest.substr(0, scheme_end) == "file")
+			return {};
+		rest.remove_prefix(scheme_end + 3);
+	}
+	else
+	{
+		// scp-like syntax needs a colon before the first slash, a drive letter isn't a host
+		const auto colon = rest.find(':');
+		if (colon == std::string_view::npos || colon < 2 || rest.find_first_of("/\\") < colon)
+			return {};
+		rest = rest.substr(0, colon);
+	}
+
+	if (const auto at = rest.find('@'); at != std::string_view::npos)
+		rest.remove_prefix(at + 1);
+
+	return std::string{ rest.substr(0, rest.find_first_of(":/")) };
+}
+
+void HostConnectionLimiter::Release(const std::string& host)
+{
+	{
+		std::lock_guard lock(mutex);
+		--connections[host];
+	}
+
+	condition.notify_all();
+}
+
+TransferThrottle::TransferThrottle(BandwidthLimiter& limiter) :
+	limiter(limiter)
+{
+}
+
+bool TransferThrottle::Update(const size_t received_bytes, const std::atomic<bool>& stop)
+{
+	if (received_bytes <= consumed)
+		return !stop;
+
+	const auto bytes = received_bytes - consumed;
+	consumed = received_bytes;
+	return limiter.Acquire(bytes, stop);
+}
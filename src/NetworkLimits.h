@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Token bucket shared by every fetch of a run, refilled at the configured rate with a burst of one second.
+// Fetches that overdraw it sleep in their transfer callback, which backs the transfer up to the server.
+class BandwidthLimiter
+{
+public:
+	// 0 disables the limit
+	void SetLimit(size_t bytes_per_second);
+	size_t GetLimit() const;
+
+	// Blocks until bytes fit in the budget, false when stop was raised meanwhile
+	bool Acquire(size_t bytes, const std::atomic<bool>& stop);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	std::mutex mutex;
+	std::atomic<size_t> limit{ 0 };
+	double tokens = 0;
+	Clock::time_point refilled_at = Clock::now();
+};
+
+// Caps concurrent connections per remote host, local paths are never capped
+class HostConnectionLimiter
+{
+public:
+	class Lease
+	{
+	public:
+		Lease() = default;
+		Lease(HostConnectionLimiter* limiter, std::string host);
+		~Lease();
+
+		Lease(const Lease& other) = delete;
+		Lease(Lease&& other) noexcept;
+		Lease& operator=(const Lease& other) = delete;
+		Lease& operator=(Lease&& other) noexcept;
+
+	private:
+		HostConnectionLimiter* limiter = nullptr;
+		std::string host;
+	};
+
+	// 0 disables the cap
+	void SetLimit(size_t connections_per_host);
+
+	// Blocks until the host of url has a free connection, false when stop was raised meanwhile
+	bool Acquire(const std::string& url, const std::atomic<bool>& stop, Lease& lease);
+
+	static std::string GetHost(const std::string& url);
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	size_t limit = 0;
+	std::map<std::string, size_t> connections;
+
+	void Release(const std::string& host);
+};
+
+// Turns cumulative byte counts of one fetch into increments for the shared limiter
+class TransferThrottle
+{
+public:
+	explicit TransferThrottle(BandwidthLimiter& limiter);
+
+	bool Update(size_t received_bytes, const std::atomic<bool>& stop);
+
+private:
+	BandwidthLimiter& limiter;
+	size_t consumed = 0;
+};
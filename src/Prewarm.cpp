@@ -0,0 +1,108 @@
+#include "Prewarm.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <ranges>
+#include <thread>
+#include <Windows.h>
+
+#include "Config.h"
+
+namespace
+{
+	constexpr DWORD ReadChunkSize = 1024 * 1024;
+
+	std::filesystem::path GetGitDir(const std::filesystem::path& repo_path)
+	{
+		auto git_path = repo_path / ".git";
+
+		// Submodules and worktrees keep a "gitdir: <path>" file instead of the directory
+		std::error_code error;
+		if (is_regular_file(git_path, error))
+		{
+			std::ifstream f{ git_path };
+			std::string line;
+			std::getline(f, line);
+
+			constexpr std::string_view prefix = "gitdir: ";
+			if (line.starts_with(prefix))
+			{
+				std::filesystem::path git_dir = line.substr(prefix.size());
+				if (git_dir.is_relative())
+					git_dir = repo_path / git_dir;
+				return git_dir.lexically_normal();
+			}
+		}
+
+		return git_path;
+	}
+
+	void CollectFiles(const std::filesystem::path& repo_path, std::vector<std::filesystem::path>& files)
+	{
+		const auto git_dir = GetGitDir(repo_path);
+		std::error_code error;
+
+		for (const auto& file : { git_dir / "index", git_dir / "packed-refs", git_dir / "objects" / "info" / "commit-graph" })
+			if (is_regular_file(file, error))
+				files.push_back(file);
+
+		for (std::filesystem::directory_iterator it{ git_dir / "objects" / "pack", error }, end; !error && it != end; it.increment(error))
+			if (it->path().extension() == ".idx")
+				files.push_back(it->path());
+	}
+
+	std::string GetVolume(const std::filesystem::path& file)
+	{
+		char volume[MAX_PATH];
+		if (GetVolumePathNameA(file.string().c_str(), volume, MAX_PATH))
+			return volume;
+		return file.root_path().string();
+	}
+
+	void ReadThrough(const std::filesystem::path& file, std::vector<char>& buffer)
+	{
+		const HANDLE handle = CreateFileA(file.string().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+			return;
+
+		DWORD bytes_read;
+		while (ReadFile(handle, buffer.data(), ReadChunkSize, &bytes_read, nullptr) && bytes_read > 0)
+		{
+		}
+
+		CloseHandle(handle);
+	}
+}
+
+void PrewarmRepositories(const std::vector<const RepoConfig*>& repositories)
+{
+	// Sorted per volume, so that spinning disks read the files in directory order
+	std::map<std::string, std::vector<std::filesystem::path>> files_per_volume;
+
+	for (const auto* repo_config : repositories)
+	{
+		std::vector<std::filesystem::path> files;
+		CollectFiles(repo_config->path, files);
+
+		for (auto& file : files)
+		{
+			auto& volume_files = files_per_volume[GetVolume(file)];
+			volume_files.push_back(std::move(file));
+		}
+	}
+
+	std::vector<std::jthread> readers;
+	for (auto& files : files_per_volume | std::views::values)
+	{
+		std::ranges::sort(files);
+		readers.emplace_back([&files]
+		{
+			std::vector<char> buffer(ReadChunkSize);
+			for (const auto& file : files)
+				ReadThrough(file, buffer);
+		});
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <vector>
+
+struct RepoConfig;
+
+// Reads pack indexes, packed-refs, the index and the commit-graph of the given repositories
+// into the OS file cache, one reader per volume, so that libgit2 later hits memory
+void PrewarmRepositories(const std::vector<const RepoConfig*>& repositories);
@@ -0,0 +1,314 @@
+#include "ProcessLauncher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Windows.h>
+
+#include "Config.h"
+#include "Data/Data.h"
+
+namespace
+{
+	// Time the step's process group gets to exit after the break before it is killed
+	constexpr std::chrono::seconds TerminateGracePeriod{ 10 };
+	// Pipe is drained between polls, the default 4 KiB buffer would stall a chatty step for most of each interval
+	constexpr DWORD OutputPipeSize = 1024 * 1024;
+	constexpr DWORD OutputReadSize = 64 * 1024;
+
+	DWORD GetPriorityClass(const SchedulingClass scheduling)
+	{
+		switch (scheduling)
+		{
+		case SchedulingClass::Batch: return BELOW_NORMAL_PRIORITY_CLASS;
+		case SchedulingClass::Idle: return IDLE_PRIORITY_CLASS;
+		case SchedulingClass::Interactive: break;
+		}
+		return NORMAL_PRIORITY_CLASS;
+	}
+
+	// Job object that kills its processes when closed, with the configured limits applied.
+	// With a memory limit, port receives the job's notifications.
+	HANDLE CreateStepJob(const ResourceLimits* limits, HANDLE& port)
+	{
+		port = nullptr;
+
+		const HANDLE job = CreateJobObjectA(nullptr, nullptr);
+		if (!job)
+			return nullptr;
+
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit_information{};
+		auto& basic_limits = limit_information.BasicLimitInformation;
+		basic_limits.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+
+		if (limits && limits->memory_max_mb != 0)
+		{
+			basic_limits.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+			limit_information.JobMemoryLimit = limits->memory_max_mb * 1024 * 1024;
+
+			// Peak usage stays below the limit, the allocation that would cross it is the one refused
+			port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+			if (port)
+			{
+				JOBOBJECT_ASSOCIATE_COMPLETION_PORT association{ job, port };
+				SetInformationJobObject(job, JobObjectAssociateCompletionPortInformation, &association, sizeof association);
+			}
+		}
+
+		if (limits && limits->max_processes != 0)
+		{
+			basic_limits.LimitFlags |= JOB_OBJECT_LIMIT_ACTIVE_PROCESS;
+			basic_limits.ActiveProcessLimit = static_cast<DWORD>(limits->max_processes);
+		}
+
+		// Enforced on the whole tree, so that tools which reset their own priority still yield
+		if (limits && limits->scheduling != SchedulingClass::Interactive)
+		{
+			basic_limits.LimitFlags |= JOB_OBJECT_LIMIT_PRIORITY_CLASS | JOB_OBJECT_LIMIT_SCHEDULING_CLASS;
+			basic_limits.PriorityClass = GetPriorityClass(limits->scheduling);
+			basic_limits.SchedulingClass = limits->scheduling == SchedulingClass::Idle ? 1 : 3;
+		}
+
+		SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limit_information, sizeof limit_information);
+
+		if (limits && limits->cpu_weight != 0)
+		{
+			// Job weights go from 1 to 9 with 5 as the even share, cgroup weights from 1 to 10000 around 100
+			const auto weight = 5.0 + 2.0 * std::log10(static_cast<double>(limits->cpu_weight) / 100.0);
+
+			JOBOBJECT_CPU_RATE_CONTROL_INFORMATION cpu_rate{};
+			cpu_rate.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | JOB_OBJECT_CPU_RATE_CONTROL_WEIGHT_BASED;
+			cpu_rate.Weight = static_cast<DWORD>(std::clamp(std::lround(weight), 1l, 9l));
+			SetInformationJobObject(job, JobObjectCpuRateControlInformation, &cpu_rate, sizeof cpu_rate);
+		}
+
+		return job;
+	}
+
+	// Memory priority isn't a job limit, it can only be set on the process the step starts
+	void SetMemoryPriority(const HANDLE process, const SchedulingClass scheduling)
+	{
+		if (scheduling == SchedulingClass::Interactive)
+			return;
+
+		MEMORY_PRIORITY_INFORMATION memory_priority{};
+		memory_priority.MemoryPriority = scheduling == SchedulingClass::Idle ? MEMORY_PRIORITY_VERY_LOW : MEMORY_PRIORITY_BELOW_NORMAL;
+		SetProcessInformation(process, ProcessMemoryPriority, &memory_priority, sizeof memory_priority);
+	}
+
+	// Drains the job's notifications without waiting
+	bool HasHitMemoryLimit(const HANDLE port)
+	{
+		if (!port)
+			return false;
+
+		bool is_hit = false;
+		DWORD message;
+		ULONG_PTR key;
+		LPOVERLAPPED overlapped;
+		while (GetQueuedCompletionStatus(port, &message, &key, &overlapped, 0))
+			is_hit |= message == JOB_OBJECT_MSG_JOB_MEMORY_LIMIT;
+
+		return is_hit;
+	}
+
+	void ReadJobUsage(const HANDLE job, ProcessUsage& usage)
+	{
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit_information{};
+		if (QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &limit_information, sizeof limit_information, nullptr))
+			usage.peak_memory = limit_information.PeakJobMemoryUsed;
+
+		// Times are in 100 ns units
+		JOBOBJECT_BASIC_ACCOUNTING_INFORMATION accounting{};
+		if (QueryInformationJobObject(job, JobObjectBasicAccountingInformation, &accounting, sizeof accounting, nullptr))
+			usage.cpu_time_ms = (accounting.TotalUserTime.QuadPart + accounting.TotalKernelTime.QuadPart) / 10000;
+	}
+}
+
+void LaunchWindowsApp(int& callback, std::stringstream& app_output, std::string& error_log,
+                      const std::string& command, const std::filesystem::path& directory,
+                      const std::atomic<bool>& stop_flag,
+                      const std::function<void(std::string_view)>& output_callback,
+                      const ResourceLimits* limits, ProcessUsage* usage,
+                      const ProcessTimeouts& timeouts)
+{
+	STARTUPINFO si = {sizeof(si)};
+	PROCESS_INFORMATION pi;
+	SECURITY_ATTRIBUTES sa = {sizeof(sa), nullptr, TRUE};
+	HANDLE h_read, h_write;
+
+	if (!CreatePipe(&h_read, &h_write, &sa, OutputPipeSize))
+	{
+		std::stringstream str;
+		str << "Failed to create pipe: " << GetLastError() << std::endl;
+		error_log = str.str();
+		return;
+	}
+
+	if (!SetHandleInformation(h_read, HANDLE_FLAG_INHERIT, 0))
+	{
+		std::stringstream str;
+		str << "Failed to set handle information: " << GetLastError() << std::endl;
+		error_log = str.str();
+		return;
+	}
+
+	HANDLE job_port;
+	const HANDLE job = CreateStepJob(limits, job_port);
+	if (!job)
+	{
+		std::stringstream str;
+		str << "Failed to create job object: " << GetLastError() << std::endl;
+		error_log = str.str();
+		CloseHandle(h_read);
+		CloseHandle(h_write);
+		return;
+	}
+
+	si.dwFlags |= STARTF_USESTDHANDLES;
+	si.hStdOutput = h_write;
+	si.hStdError = h_write;
+
+	const auto scheduling = limits ? limits->scheduling : SchedulingClass::Interactive;
+	// Own process group, so that an expired timeout can send the break to the step's tree only
+	const bool has_timeout = timeouts.wall_clock.count() > 0 || timeouts.inactivity.count() > 0;
+
+	// Started suspended, so that no child can be spawned before the process is in the job
+	if (CreateProcess(
+		nullptr,
+		const_cast<char*>(command.c_str()),
+		nullptr,
+		nullptr,
+		TRUE,
+		CREATE_SUSPENDED | GetPriorityClass(scheduling) | (has_timeout ? CREATE_NEW_PROCESS_GROUP : 0),
+		nullptr,
+		directory.string().c_str(),
+		&si,
+		&pi
+	))
+	{
+		CloseHandle(h_write);
+
+		// Jobs nest since Windows 8, should the assignment still fail the step runs uncontained
+		AssignProcessToJobObject(job, pi.hProcess);
+		SetMemoryPriority(pi.hProcess, scheduling);
+		ResumeThread(pi.hThread);
+
+		using Clock = std::chrono::steady_clock;
+		const auto started_at = Clock::now();
+		auto output_at = started_at;
+		std::string expiry;
+		Clock::time_point break_sent_at;
+		bool hit_memory_limit = false;
+
+		// Only what is already in the pipe is read, a blocking read would never return while the process is silent
+		std::string buffer(OutputReadSize, '\0');
+		const auto forward_output = [&]
+		{
+			DWORD available = 0;
+			while (PeekNamedPipe(h_read, nullptr, 0, nullptr, &available, nullptr) && available > 0)
+			{
+				DWORD bytes_read;
+				if (!ReadFile(h_read, buffer.data(), std::min<DWORD>(available, OutputReadSize), &bytes_read, nullptr) || bytes_read == 0)
+					break;
+
+				const std::string_view chunk{ buffer.data(), bytes_read };
+				if (output_callback)
+					output_callback(chunk);
+				else app_output << chunk;
+
+				output_at = Clock::now();
+			}
+		};
+
+		// Wait until child process exits
+		while (WaitForSingleObject(pi.hProcess, 50) == WAIT_TIMEOUT)
+		{
+			if (stop_flag)
+			{
+				TerminateJobObject(job, 1);
+				TerminateProcess(pi.hProcess, 1);
+				CloseHandle(pi.hProcess);
+				CloseHandle(pi.hThread);
+				CloseHandle(h_read);
+				CloseHandle(job);
+				if (job_port)
+					CloseHandle(job_port);
+				return;
+			}
+
+			forward_output();
+			hit_memory_limit |= HasHitMemoryLimit(job_port);
+
+			const auto now = Clock::now();
+			if (expiry.empty())
+			{
+				std::stringstream str;
+				if (timeouts.wall_clock.count() > 0 && now - started_at > timeouts.wall_clock)
+					str << "Timed out after " << timeouts.wall_clock.count() << " s";
+				else if (timeouts.inactivity.count() > 0 && now - output_at > timeouts.inactivity)
+					str << "No output for " << timeouts.inactivity.count() << " s";
+				expiry = str.str();
+
+				// Break lets the group clean up, without a shared console it can't be delivered and the group is killed at once
+				if (!expiry.empty())
+				{
+					break_sent_at = now;
+					if (!GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, pi.dwProcessId))
+						TerminateJobObject(job, 1);
+				}
+			}
+			else if (now - break_sent_at > TerminateGracePeriod)
+			{
+				TerminateJobObject(job, 1);
+				TerminateProcess(pi.hProcess, 1);
+			}
+		}
+
+		forward_output();
+		hit_memory_limit |= HasHitMemoryLimit(job_port);
+
+		DWORD exit_code;
+		if (!expiry.empty())
+		{
+			// Process may have handled the break and exited cleanly, it still failed
+			callback = WAIT_TIMEOUT;
+			error_log = std::move(expiry);
+		}
+		else if (GetExitCodeProcess(pi.hProcess, &exit_code))
+		{
+			callback = static_cast<int>(exit_code);
+		}
+		else
+		{
+			std::stringstream str;
+			str << "Failed to get exit code: " << GetLastError();
+			error_log = str.str();
+		}
+
+		if (usage)
+		{
+			ReadJobUsage(job, *usage);
+			usage->hit_memory_limit = hit_memory_limit;
+		}
+
+		// Close process and thread handles, closing the job also ends processes the step left behind
+		CloseHandle(h_read);
+		CloseHandle(pi.hProcess);
+		CloseHandle(pi.hThread);
+		CloseHandle(job);
+		if (job_port)
+			CloseHandle(job_port);
+	}
+	else
+	{
+		error_log = "Failed to create process " + command;
+		CloseHandle(job);
+		if (job_port)
+			CloseHandle(job_port);
+	}
+}
+
+void EnterBackgroundMode()
+{
+	SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN);
+}
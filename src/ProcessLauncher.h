@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <sstream>
+#include <string>
+
+struct ProcessUsage;
+struct ResourceLimits;
+
+// Expiry of a launched process, zero disables a timeout
+struct ProcessTimeouts
+{
+	std::chrono::seconds wall_clock{ 0 };
+	// Time without any output on stdout or stderr
+	std::chrono::seconds inactivity{ 0 };
+};
+
+// Runs command in directory, collecting stdout and stderr into app_output until it exits or stop_flag is raised.
+// When output_callback is set, output chunks are passed to it instead.
+// The process tree runs in a job object that applies limits and scheduling class, is killed as a whole on stop,
+// and reports its peak memory, CPU time and whether it hit its memory limit into usage on exit.
+// An expired timeout sends a break to the process group, kills the tree after a grace period and fails the run.
+void LaunchWindowsApp(int& callback, std::stringstream& app_output, std::string& error_log,
+                      const std::string& command, const std::filesystem::path& directory,
+                      const std::atomic<bool>& stop_flag,
+                      const std::function<void(std::string_view)>& output_callback = {},
+                      const ResourceLimits* limits = nullptr, ProcessUsage* usage = nullptr,
+                      const ProcessTimeouts& timeouts = {});
+
+// Lowers CPU, IO and memory priority of mgit itself, for runs started by a scheduler
+void EnterBackgroundMode();
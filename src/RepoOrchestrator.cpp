@@ -1,16 +1,20 @@
 #include "RepoOrchestrator.h"
 
 #include "Config.h"
+#include "RunContext.h"
 #include "Tasks/CheckoutTask.h"
 #include "Tasks/CleanupTask.h"
 #include "Tasks/CommandTask.h"
+#include "Tasks/ObjectPoolTask.h"
+#include "Tasks/PrefetchTask.h"
 #include "Tasks/PullPrepareTask.h"
 #include "Tasks/PullTask.h"
 #include "Tasks/PushTask.h"
 #include "Tasks/StatusTask.h"
 
-RepoOrchestrator::RepoOrchestrator(const RepoConfig& repo_config, const size_t sub_repo_level) :
+RepoOrchestrator::RepoOrchestrator(const RepoConfig& repo_config, const size_t sub_repo_level, RunContext& run_context) :
 	repo_config(repo_config),
+	run_context(run_context),
 	info(sub_repo_level)
 {
 }
@@ -23,11 +27,16 @@ void RepoOrchestrator::Launch()
 	}
 }
 
-void RepoOrchestrator::Stop()
+void RepoOrchestrator::RequestStop()
 {
 	should_stop = true;
 	for (const auto & step_data : steps)
 		step_data->task->Stop();
+}
+
+void RepoOrchestrator::Stop()
+{
+	RequestStop();
 
 	if(running_thread.joinable())
 		running_thread.join();
@@ -54,9 +63,41 @@ bool RepoOrchestrator::HasError() const
 
 bool RepoOrchestrator::IsComplete() const
 {
+	if (is_retrying)
+		return current_task_index >= static_cast<int64_t>(steps.size());
 	return current_task_index > last_task;
 }
 
+bool RepoOrchestrator::IsQueued() const
+{
+	return is_queued;
+}
+
+void RepoOrchestrator::SuspendStep()
+{
+	step_pool_lease = {};
+	if (step_controller && holds_controller_slot)
+		step_controller->Yield();
+	holds_controller_slot = false;
+	suspended_at = std::chrono::steady_clock::now();
+}
+
+bool RepoOrchestrator::ResumeStep()
+{
+	if (!step_pool)
+		return true;
+
+	// Same order as RunStep, a step holding the adaptive slot while queueing for the pool could deadlock
+	is_queued = true;
+	const bool is_admitted = step_pool->Acquire(step_weight, should_stop, step_pool_lease)
+		&& (!step_controller || step_controller->Acquire(should_stop));
+	is_queued = false;
+
+	holds_controller_slot = is_admitted && step_controller != nullptr;
+	suspended_for += std::chrono::steady_clock::now() - suspended_at;
+	return is_admitted;
+}
+
 void RepoOrchestrator::RegisterChild(const std::shared_ptr<RepoOrchestrator>& child)
 {
 	children.insert(child);
@@ -84,11 +125,33 @@ void RepoOrchestrator::PlanStatusJob()
 	PlanJob<StatusTask>();
 }
 
+void RepoOrchestrator::PlanQuietStatusJob()
+{
+	PlanJob<QuietStatusTask>();
+}
+
 void RepoOrchestrator::PlanPullPrepareJob()
 {
 	PlanJob<PullPrepareTask>();
 }
 
+void RepoOrchestrator::PlanPullCheckJob()
+{
+	PlanJob<PullCheckTask>();
+}
+
+void RepoOrchestrator::PlanPrefetchJob()
+{
+	PlanJob<PrefetchTask>();
+}
+
+void RepoOrchestrator::PlanObjectPoolJob(const std::vector<const RepoConfig*>& repositories)
+{
+	auto step = std::make_shared<StepData>(steps.size());
+	step->task = std::make_unique<ObjectPoolTask>(this, *step, repositories);
+	steps.push_back(std::move(step));
+}
+
 void RepoOrchestrator::PlanBuildJobs()
 {
 	PlanBuildJobs(repo_config.build.steps);
@@ -146,6 +209,7 @@ void RepoOrchestrator::ClearSteps()
 	last_task = 0;
 	current_task_index = -1;
 	error_encountered = false;
+	is_retrying = false;
 	should_stop = false;
 	steps.clear();
 }
@@ -160,6 +224,11 @@ RepositoryInformation& RepoOrchestrator::GetRepositoryInfo()
 	return info;
 }
 
+RunContext& RepoOrchestrator::GetRunContext() const
+{
+	return run_context;
+}
+
 std::string_view RepoOrchestrator::GetAwait() const
 {
 	if (await_list.empty())
@@ -201,6 +270,14 @@ std::string RepoOrchestrator::GetActiveOutput() const
 	return steps[index]->output.str();
 }
 
+ProcessUsage RepoOrchestrator::GetActiveUsage() const
+{
+	const int64_t index = current_task_index;
+	if (index == -1 || index >= static_cast<int64_t>(steps.size()))
+		return {};
+	return steps[index]->usage;
+}
+
 void RepoOrchestrator::PlanCheckoutPullJob(const RepoConfig& config)
 {
 	auto checkout_step_data = std::make_shared<StepData>(steps.size());
@@ -219,12 +296,12 @@ void RepoOrchestrator::PlanCheckoutPullJob(const RepoConfig& config)
 		PlanCheckoutPullJob(child);
 }
 
-void RepoOrchestrator::PlanBuildJobs(const std::vector<std::string>& jobs)
+void RepoOrchestrator::PlanBuildJobs(const std::vector<BuildStep>& jobs)
 {
-	for (const auto& command : jobs)
+	for (const auto& build_step : jobs)
 	{
 		auto step = std::make_shared<StepData>(steps.size());
-		step->task = std::make_unique<CommandTask>(this, *step, command);
+		step->task = std::make_unique<CommandTask>(this, *step, build_step);
 		steps.push_back(std::move(step));
 	}
 }
@@ -236,9 +313,10 @@ void RepoOrchestrator::CreateAwaitList()
 
 void RepoOrchestrator::HandleError()
 {
-	if(last_task != static_cast<int64_t>(steps.size() - 1))
+	// If last task is not the last one - retry procedure is enabled, and it runs once
+	if(last_task != static_cast<int64_t>(steps.size() - 1) && !is_retrying)
 	{
-		// If last task is not the last one - retry procedure is enabled
+		is_retrying = true;
 		current_task_index = last_task + 1;
 	}
 	else
@@ -260,13 +338,19 @@ void RepoOrchestrator::InternalRun()
 	if (should_stop)
 		return;
 
+	// Retry steps follow the last task and run until the end of the plan
+	const auto get_end = [this]
+	{
+		return is_retrying ? static_cast<int64_t>(steps.size()) - 1 : last_task;
+	};
+
 	current_task_index = 0;
-	while(current_task_index <= last_task)
+	while(current_task_index <= get_end())
 	{
 		const auto& current_step = steps[current_task_index];
 
 		current_step->initialized = true;
-		const bool result = current_step->task->Run();
+		const bool result = RunStep(*current_step->task);
 		current_step->completed = true;
 
 		if (should_stop)
@@ -282,6 +366,62 @@ void RepoOrchestrator::InternalRun()
 		to_notify->Notify(repo_config.repo_name);
 }
 
+bool RepoOrchestrator::RunStep(Task& task)
+{
+	const auto resource_class = task.GetResourceClass();
+
+	ResourcePool* pool = nullptr;
+	ConcurrencyController* controller = nullptr;
+	switch (resource_class)
+	{
+	case ResourceClass::Network:
+		pool = &run_context.network_pool;
+		controller = &run_context.network_concurrency;
+		break;
+	case ResourceClass::Disk:
+		pool = &run_context.disk_pool;
+		controller = &run_context.disk_concurrency;
+		break;
+	case ResourceClass::Cpu:
+		pool = &run_context.cpu_pool;
+		break;
+	case ResourceClass::None:
+		return task.Run();
+	}
+
+	// Device slot comes first and the adaptive limit last, so that tasks stuck behind
+	// a slow device or a full pool don't hold slots others could use
+	DeviceQueues::Lease device_lease;
+	Jobserver::Lease jobserver_lease;
+	step_pool = pool;
+	step_weight = task.GetResourceWeight();
+	step_controller = controller;
+	is_queued = true;
+	const bool is_admitted = (resource_class != ResourceClass::Disk || run_context.device_queues.Acquire(repo_config.path, should_stop, device_lease))
+		&& pool->Acquire(step_weight, should_stop, step_pool_lease)
+		&& (resource_class != ResourceClass::Cpu || run_context.jobserver.Acquire(step_weight, should_stop, jobserver_lease))
+		&& (!controller || controller->Acquire(should_stop));
+	is_queued = false;
+
+	bool result = false;
+	if (is_admitted)
+	{
+		holds_controller_slot = controller != nullptr;
+		suspended_for = {};
+		const auto start = std::chrono::steady_clock::now();
+		result = task.Run();
+		// A stopped task says nothing about the resource it was using
+		if (holds_controller_slot)
+			controller->Release(std::chrono::steady_clock::now() - start - suspended_for, task.GetLatencySample(), result || should_stop);
+	}
+
+	step_pool_lease = {};
+	step_pool = nullptr;
+	step_controller = nullptr;
+	holds_controller_slot = false;
+	return result;
+}
+
 template <class TJob>
 void RepoOrchestrator::PlanJob()
 {
@@ -1,13 +1,19 @@
 #pragma once
+#include <chrono>
 #include <mutex>
 #include <set>
 #include <thread>
 #include <vector>
 
 #include "Data/Data.h"
+#include "ResourcePool.h"
 
+class ConcurrencyController;
 class MultiController;
+class Task;
+struct BuildStep;
 struct RepoConfig;
+struct RunContext;
 
 enum class OrchestratorStatus
 {
@@ -20,14 +26,22 @@ enum class OrchestratorStatus
 class RepoOrchestrator
 {
 public:
-	RepoOrchestrator(const RepoConfig& repo_config, size_t sub_repo_level);
+	RepoOrchestrator(const RepoConfig& repo_config, size_t sub_repo_level, RunContext& run_context);
 
 	void Launch();
+	void RequestStop();
 	void Stop();
 
 	OrchestratorStatus GetCurrentStatus() const;
 	bool HasError() const;
 	bool IsComplete() const;
+	// Waiting for a concurrency slot of its resource class
+	bool IsQueued() const;
+
+	// The running step waits on another repository, its pool slot and adaptive slot are free until it resumes.
+	// Resuming queues for them in admission order, false when stop was raised meanwhile.
+	void SuspendStep();
+	bool ResumeStep();
 
 	void RegisterListener(RepoOrchestrator* notified);
 	void Notify(const std::string& notifier);
@@ -36,7 +50,11 @@ public:
 	const std::set<std::shared_ptr<RepoOrchestrator>>& GetChildren() const;
 
 	void PlanStatusJob();
+	void PlanQuietStatusJob();
 	void PlanPullPrepareJob();
+	void PlanPullCheckJob();
+	void PlanPrefetchJob();
+	void PlanObjectPoolJob(const std::vector<const RepoConfig*>& repositories);
 	void PlanBuildJobs();
 	void PlanPullJob();
 	void PlanCheckoutPullJob();
@@ -44,15 +62,18 @@ public:
 
 	const RepoConfig& GetConfig() const;
 	RepositoryInformation& GetRepositoryInfo();
+	RunContext& GetRunContext() const;
 	std::string_view GetAwait() const;
 	int64_t GetActiveId() const;
 	size_t GetSize() const;
 	std::string_view GetActiveCommand() const;
 	std::string_view GetErrorString() const;
 	std::string GetActiveOutput() const;
+	ProcessUsage GetActiveUsage() const;
 
 private:
 	const RepoConfig& repo_config;
+	RunContext& run_context;
 	RepositoryInformation info;
 	std::set<std::shared_ptr<RepoOrchestrator>> children;
 
@@ -66,12 +87,24 @@ private:
 
 	std::atomic<int64_t> current_task_index{ -1 };
 	std::atomic<bool> error_encountered{ false };
+	std::atomic<bool> is_queued{ false };
+	std::atomic<bool> is_retrying{ false };
 
 	std::atomic<bool> should_stop{ false };
 	std::jthread running_thread;
 
+	// Slots of the running step
+	ResourcePool* step_pool = nullptr;
+	size_t step_weight = 0;
+	ResourcePool::Lease step_pool_lease;
+	ConcurrencyController* step_controller = nullptr;
+	bool holds_controller_slot = false;
+	// Time the step spent suspended, it says nothing about the resource
+	std::chrono::steady_clock::time_point suspended_at;
+	std::chrono::steady_clock::duration suspended_for{};
+
 	void PlanCheckoutPullJob(const RepoConfig& config);
-	void PlanBuildJobs(const std::vector<std::string>& jobs);
+	void PlanBuildJobs(const std::vector<BuildStep>& jobs);
 	void CreateAwaitList();
 
 	template<class TJob>
@@ -79,4 +112,5 @@ private:
 
 	void HandleError();	
 	void InternalRun();
+	bool RunStep(Task& task);
 };
@@ -0,0 +1,91 @@
+#include "ResourcePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+ResourcePool::Lease::Lease(ResourcePool* pool, const size_t weight) :
+	pool(pool),
+	weight(weight)
+{
+}
+
+ResourcePool::Lease::~Lease()
+{
+	if (pool)
+		pool->Release(weight);
+}
+
+ResourcePool::Lease::Lease(Lease&& other) noexcept :
+	pool(std::exchange(other.pool, nullptr)),
+	weight(other.weight)
+{
+}
+
+ResourcePool::Lease& ResourcePool::Lease::operator=(Lease&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (pool)
+			pool->Release(weight);
+
+		pool = std::exchange(other.pool, nullptr);
+		weight = other.weight;
+	}
+	return *this;
+}
+
+void ResourcePool::SetCapacity(const size_t weight_units)
+{
+	{
+		std::lock_guard lock(mutex);
+		capacity = weight_units;
+	}
+
+	condition.notify_all();
+}
+
+bool ResourcePool::Acquire(const size_t weight, const std::atomic<bool>& stop, Lease& lease)
+{
+	std::unique_lock lock(mutex);
+	if (capacity == 0)
+		return true;
+
+	const auto ticket = next_ticket++;
+	waiting.push_back(ticket);
+
+	const auto granted = std::clamp<size_t>(weight, 1, capacity);
+	while (waiting.front() != ticket || in_use + granted > capacity)
+	{
+		if (stop)
+		{
+			std::erase(waiting, ticket);
+			lock.unlock();
+			// Task queued behind this one may fit now
+			condition.notify_all();
+			return false;
+		}
+
+		// Stop flag isn't tied to the condition, check it periodically
+		condition.wait_for(lock, std::chrono::milliseconds{ 100 });
+	}
+
+	waiting.pop_front();
+	in_use += granted;
+	lease = Lease{ this, granted };
+	lock.unlock();
+
+	// Next in line may fit as well
+	condition.notify_all();
+	return true;
+}
+
+void ResourcePool::Release(const size_t weight)
+{
+	{
+		std::lock_guard lock(mutex);
+		in_use -= weight;
+	}
+
+	condition.notify_all();
+}
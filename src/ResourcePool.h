@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Weighted slots for tasks of one resource class. Waiting tasks are admitted in arrival order,
+// so a heavy or exclusive task isn't starved by a stream of light ones.
+class ResourcePool
+{
+public:
+	class Lease
+	{
+	public:
+		Lease() = default;
+		Lease(ResourcePool* pool, size_t weight);
+		~Lease();
+
+		Lease(const Lease& other) = delete;
+		Lease(Lease&& other) noexcept;
+		Lease& operator=(const Lease& other) = delete;
+		Lease& operator=(Lease&& other) noexcept;
+
+	private:
+		ResourcePool* pool = nullptr;
+		size_t weight = 0;
+	};
+
+	// 0 disables the pool
+	void SetCapacity(size_t weight_units);
+
+	// Blocks until weight fits next to the running tasks, false when stop was raised meanwhile.
+	// Weights above the capacity take the whole pool.
+	bool Acquire(size_t weight, const std::atomic<bool>& stop, Lease& lease);
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	size_t capacity = 0;
+	size_t in_use = 0;
+	uint64_t next_ticket = 0;
+	std::deque<uint64_t> waiting;
+
+	void Release(size_t weight);
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include "ConcurrencyController.h"
+#include "DeviceQueues.h"
+#include "FetchCoordinator.h"
+#include "Jobserver.h"
+#include "NetworkLimits.h"
+#include "ResourcePool.h"
+
+// State shared by every orchestrator of a single mgit run
+struct RunContext
+{
+	FetchCoordinator fetch_coordinator;
+	BandwidthLimiter bandwidth_limiter;
+	HostConnectionLimiter host_limiter;
+	ResourcePool network_pool;
+	ResourcePool disk_pool;
+	ResourcePool cpu_pool;
+	Jobserver jobserver;
+	ConcurrencyController network_concurrency{ "Network" };
+	ConcurrencyController disk_concurrency{ "Disk" };
+	DeviceQueues device_queues;
+};
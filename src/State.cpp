@@ -0,0 +1,49 @@
+#include "State.h"
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, RemoteState& p)
+{
+	if (j.contains("last_fetch"))
+		j.at("last_fetch").get_to(p.last_fetch);
+	if (j.contains("connect_ms"))
+		j.at("connect_ms").get_to(p.connect_ms);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void to_json(nlohmann::json& j, const RemoteState& p)
+{
+	j["last_fetch"] = p.last_fetch;
+	j["connect_ms"] = p.connect_ms;
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, RepoState& p)
+{
+	if (j.contains("was_dirty"))
+		j.at("was_dirty").get_to(p.was_dirty);
+	if (j.contains("status_scan_ms"))
+		j.at("status_scan_ms").get_to(p.status_scan_ms);
+	if (j.contains("remotes"))
+		j.at("remotes").get_to(p.remotes);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void to_json(nlohmann::json& j, const RepoState& p)
+{
+	j["was_dirty"] = p.was_dirty;
+	j["status_scan_ms"] = p.status_scan_ms;
+	j["remotes"] = p.remotes;
+}
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, State& p)
+{
+	if (j.contains("repositories"))
+		j.at("repositories").get_to(p.repositories);
+}
+
+// ReSharper disable once CppInconsistentNaming
+void to_json(nlohmann::json& j, const State& p)
+{
+	j["repositories"] = p.repositories;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <map>
+#include <string>
+
+#include "json.hpp"
+
+struct RemoteState
+{
+	// Unix time of the last successful fetch
+	int64_t last_fetch = 0;
+	// Smoothed connect latency, -1 until first measured
+	int64_t connect_ms = -1;
+};
+
+// Data remembered between mgit runs, keyed by repository path
+struct RepoState
+{
+	bool was_dirty = false;
+	int64_t status_scan_ms = -1;
+	std::map<std::string, RemoteState> remotes;
+};
+
+struct State
+{
+	std::map<std::string, RepoState> repositories;
+};
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, RemoteState& p);
+
+// ReSharper disable once CppInconsistentNaming
+void to_json(nlohmann::json& j, const RemoteState& p);
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, RepoState& p);
+
+// ReSharper disable once CppInconsistentNaming
+void to_json(nlohmann::json& j, const RepoState& p);
+
+// ReSharper disable once CppInconsistentNaming
+void from_json(const nlohmann::json& j, State& p);
+
+// ReSharper disable once CppInconsistentNaming
+void to_json(nlohmann::json& j, const State& p);
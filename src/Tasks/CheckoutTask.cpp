@@ -37,6 +37,11 @@ std::string_view CheckoutTask::GetCommand()
 	return "Checkout";
 }
 
+ResourceClass CheckoutTask::GetResourceClass() const
+{
+	return ResourceClass::Disk;
+}
+
 TargetedCheckoutTask::TargetedCheckoutTask(RepoOrchestrator* repo_orchestrator, StepData& step,
 	const RepoConfig& repo_config) :
 		CheckoutTask(repo_orchestrator, step),
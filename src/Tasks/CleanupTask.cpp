@@ -15,6 +15,11 @@ std::string_view CleanupTask::GetCommand()
 	return "Cleanup";
 }
 
+ResourceClass CleanupTask::GetResourceClass() const
+{
+	return ResourceClass::Disk;
+}
+
 TargetedCleanupTask::TargetedCleanupTask(RepoOrchestrator* repo_orchestrator, StepData& step,
 	const RepoConfig& repo_config) :
 		CleanupTask(repo_orchestrator, step),
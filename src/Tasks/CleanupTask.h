@@ -8,6 +8,7 @@ public:
 
 	bool Run() override;
 	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
 };
 
 class TargetedCleanupTask final : public CleanupTask
@@ -1,125 +1,27 @@
 #include "CommandTask.h"
 
 #include <filesystem>
-#include <Windows.h>
+#include <limits>
 
 #include "Config.h"
+#include "GitLibRuntime.h"
+#include "ProcessLauncher.h"
 #include "RepoOrchestrator.h"
 
-namespace
+CommandTask::CommandTask(RepoOrchestrator* repo_orchestrator, StepData& step, std::string command) :
+	Task(repo_orchestrator, step),
+	command(std::move(command))
 {
-	void LaunchWindowsApp(int& callback, std::stringstream& app_output, std::string& error_log,
-	                      const std::string& command, const std::filesystem::path& directory,
-	                      const std::atomic<bool>& stop_flag)
-	{
-		STARTUPINFO si = {sizeof(si)};
-		PROCESS_INFORMATION pi;
-		SECURITY_ATTRIBUTES sa = {sizeof(sa), nullptr, TRUE};
-		HANDLE h_read, h_write;
-
-		if (!CreatePipe(&h_read, &h_write, &sa, 0))
-		{
-			std::stringstream str;
-			str << "Failed to create pipe: " << GetLastError() << std::endl;
-			error_log = str.str();
-			return;
-		}
-
-		if (!SetHandleInformation(h_read, HANDLE_FLAG_INHERIT, 0))
-		{
-			std::stringstream str;
-			str << "Failed to set handle information: " << GetLastError() << std::endl;
-			error_log = str.str();
-			return;
-		}
-
-		si.dwFlags |= STARTF_USESTDHANDLES;
-		si.hStdOutput = h_write;
-		si.hStdError = h_write;
-
-		if (CreateProcess(
-			nullptr,
-			const_cast<char*>(command.c_str()),
-			nullptr,
-			nullptr,
-			TRUE,
-			0,
-			nullptr,
-			directory.string().c_str(),
-			&si,
-			&pi
-		))
-		{
-			CloseHandle(h_write);
-
-			// Wait until child process exits
-			DWORD status;
-			do
-			{
-				if (stop_flag)
-				{
-					TerminateProcess(pi.hProcess, 1);
-					CloseHandle(pi.hProcess);
-					CloseHandle(pi.hThread);
-					CloseHandle(h_read);
-					return;
-				}
-
-				status = WaitForSingleObject(pi.hProcess, 0);
-
-				char buffer[4096];
-				DWORD bytes_read;
-				while (ReadFile(h_read, buffer, sizeof(buffer) - 1, &bytes_read, nullptr))
-				{
-					if (bytes_read > 0)
-					{
-						buffer[bytes_read] = '\0';
-						app_output << buffer;
-					}
-					else
-					{
-						break;
-					}
-
-					if (stop_flag)
-					{
-						TerminateProcess(pi.hProcess, 1);
-						CloseHandle(pi.hProcess);
-						CloseHandle(pi.hThread);
-						CloseHandle(h_read);
-						return;
-					}
-				}
-			}
-			while (status == WAIT_TIMEOUT);
-
-			DWORD exit_code;
-			if (GetExitCodeProcess(pi.hProcess, &exit_code))
-			{
-				callback = static_cast<int>(exit_code);
-			}
-			else
-			{
-				std::stringstream str;
-				str << "Failed to get exit code: " << GetLastError();
-				error_log = str.str();
-			}
-
-			// Close process and thread handles
-			CloseHandle(h_read);
-			CloseHandle(pi.hProcess);
-			CloseHandle(pi.hThread);
-		}
-		else
-		{
-			error_log = "Failed to create process " + command;
-		}
-	}
 }
 
-CommandTask::CommandTask(RepoOrchestrator* repo_orchestrator, StepData& step, std::string command) :
+CommandTask::CommandTask(RepoOrchestrator* repo_orchestrator, StepData& step, const BuildStep& build_step) :
 	Task(repo_orchestrator, step),
-	command(std::move(command))
+	command(build_step.command),
+	weight(build_step.weight),
+	is_exclusive(build_step.exclusive),
+	timeout_seconds(build_step.timeout_seconds),
+	inactivity_timeout_seconds(build_step.inactivity_timeout_seconds),
+	is_build_step(true)
 {
 }
 
@@ -137,9 +39,17 @@ bool CommandTask::Run()
 
 	TASK_RUNNER_CHECK;
 
+	GitLibRuntime::Instance().EvictIdle(config.path);
+
 	int callback = 255;
 	std::string error_log;
-	LaunchWindowsApp(callback, step_data.output, error_log, command, working_dir, should_stop);
+	const ResourceLimits* limits = is_build_step ? &config.build.limits : nullptr;
+	const ProcessTimeouts timeouts{
+		std::chrono::seconds{ static_cast<int64_t>(timeout_seconds) },
+		std::chrono::seconds{ static_cast<int64_t>(inactivity_timeout_seconds) }
+	};
+	LaunchWindowsApp(callback, step_data.output, error_log, command, working_dir, should_stop, {},
+		limits, &step_data.usage, timeouts);
 
 	TASK_RUNNER_CHECK;
 
@@ -147,6 +57,8 @@ bool CommandTask::Run()
 	{
 		if (!error_log.empty())
 			step_data.error = std::move(error_log);
+		else if (limits && step_data.usage.hit_memory_limit)
+			step_data.error = "Command failed after reaching its memory limit of " + std::to_string(limits->memory_max_mb) + " MiB";
 		else
 			step_data.error = "Command failed";
 
@@ -160,3 +72,14 @@ std::string_view CommandTask::GetCommand()
 {
 	return command;
 }
+
+ResourceClass CommandTask::GetResourceClass() const
+{
+	return ResourceClass::Cpu;
+}
+
+size_t CommandTask::GetResourceWeight() const
+{
+	// Pool clamps the weight to its capacity
+	return is_exclusive ? std::numeric_limits<size_t>::max() : weight;
+}
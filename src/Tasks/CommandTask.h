@@ -3,14 +3,25 @@
 
 #include "Task.h"
 
+struct BuildStep;
+
 class CommandTask : public Task
 {
 public:
 	explicit CommandTask(RepoOrchestrator* repo_orchestrator, StepData& step, std::string command);
+	explicit CommandTask(RepoOrchestrator* repo_orchestrator, StepData& step, const BuildStep& build_step);
 
 	bool Run() override;
 	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
+	size_t GetResourceWeight() const override;
 
 private:
 	std::string command;
+	size_t weight = 1;
+	bool is_exclusive = false;
+	size_t timeout_seconds = 0;
+	size_t inactivity_timeout_seconds = 0;
+	// Build limits and priority apply to build steps, git commands that share this task run at normal priority
+	bool is_build_step = false;
 };
@@ -0,0 +1,189 @@
+#include "ObjectPoolTask.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <map>
+
+#include "Config.h"
+#include "GitLibLock.h"
+#include "RepoOrchestrator.h"
+#include "RunContext.h"
+
+namespace
+{
+	auto DefaultRemote = "origin";
+
+	// Pool refs keep fetched objects reachable, one namespace per source URL. The name is derived
+	// from the URL alone, so that every mgit build finds the refs written by earlier ones.
+	std::string GetPoolNamespace(const std::string& url)
+	{
+		std::string name = url;
+		std::ranges::replace_if(name, [](const char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_'; }, '_');
+		return name;
+	}
+}
+
+ObjectPoolTask::ObjectPoolTask(RepoOrchestrator* repo_orchestrator, StepData& step, const std::vector<const RepoConfig*>& repositories) :
+	Task(repo_orchestrator, step),
+	stage("Preparing object pool"),
+	repositories(repositories)
+{
+}
+
+bool ObjectPoolTask::Run()
+{
+	const auto& config = GetConfig();
+
+	stage = "Opening object pool";
+	GitLibLock pool;
+	if (!pool.OpenOrCreateBareRepo(config.path))
+	{
+		step_data.error = "Couldn't open or create object pool";
+		return false;
+	}
+
+	const auto pool_objects = (std::filesystem::absolute(config.path) / "objects").generic_string();
+
+	// Mirrors come first, most objects are then copied locally instead of downloaded
+	std::vector<std::string> mirror_urls;
+	std::vector<std::string> origin_urls;
+
+	stage = "Wiring alternates";
+	for (const auto* repository : repositories)
+	{
+		TASK_RUNNER_CHECK;
+
+		std::string mirror_url, origin_url;
+		if (!WireRepository(*repository, pool_objects, mirror_url, origin_url))
+			continue;
+
+		if (!mirror_url.empty() && std::ranges::find(mirror_urls, mirror_url) == mirror_urls.end())
+			mirror_urls.push_back(mirror_url);
+		if (!origin_url.empty() && std::ranges::find(origin_urls, origin_url) == origin_urls.end())
+			origin_urls.push_back(origin_url);
+	}
+
+	std::erase_if(origin_urls, [&mirror_urls](const std::string& url) { return std::ranges::find(mirror_urls, url) != mirror_urls.end(); });
+
+	stage = "Fetching into object pool";
+	size_t fetched = 0;
+	for (const auto* urls : { &mirror_urls, &origin_urls })
+	{
+		for (const auto& url : *urls)
+		{
+			TASK_RUNNER_CHECK;
+			if (FetchIntoPool(pool, url))
+				++fetched;
+		}
+	}
+
+	if (fetched == 0 && !(mirror_urls.empty() && origin_urls.empty()))
+	{
+		step_data.error = "Couldn't fetch any remote into object pool";
+		return false;
+	}
+
+	stage = "Complete";
+	return true;
+}
+
+std::string_view ObjectPoolTask::GetCommand()
+{
+	return stage.load();
+}
+
+ResourceClass ObjectPoolTask::GetResourceClass() const
+{
+	return ResourceClass::Network;
+}
+
+bool ObjectPoolTask::WireRepository(const RepoConfig& repository, const std::string& pool_objects, std::string& mirror_url, std::string& origin_url)
+{
+	GitLibLock git;
+	if (!git.OpenRepo(repository.path))
+	{
+		step_data.output << "Couldn't open " << repository.repo_name << ", skipping\n";
+		return false;
+	}
+
+	if (!git.AddAlternate(pool_objects))
+	{
+		step_data.output << "Couldn't add object pool as alternate of " << repository.repo_name << '\n';
+		return false;
+	}
+
+	if (!repository.local_repo.empty())
+		git.GetRemoteUrl(repository.local_repo, mirror_url);
+	git.GetRemoteUrl(DefaultRemote, origin_url);
+
+	step_data.output << repository.repo_name << " borrows objects from the pool\n";
+	return true;
+}
+
+bool ObjectPoolTask::FetchIntoPool(GitLibLock& pool, const std::string& url)
+{
+	std::function<int(const char*)> remote_text_func = [this](const char*)
+	{
+		return should_stop ? -1 : 0;
+	};
+
+	TransferThrottle throttle(GetRunContext().bandwidth_limiter);
+	std::function<int(const TransferStats&)> transfer_func = [this, &throttle](const TransferStats& stats)
+	{
+		if (!throttle.Update(stats.received_bytes, should_stop))
+			return -1;
+
+		GetRepositoryInformation().transfer.Store(stats);
+		return 0;
+	};
+
+	HostConnectionLimiter::Lease host_lease;
+	if (!GetRunContext().host_limiter.Acquire(url, should_stop, host_lease))
+		return false;
+
+	const auto pool_namespace = GetPoolNamespace(url);
+	const auto pool_prefix = "refs/pool/" + pool_namespace + '/';
+
+	std::map<std::string, std::string> previous_tips;
+	if (!pool.ListReferences(pool_prefix + '*', previous_tips))
+		return false;
+
+	GitFetchSettings settings;
+	settings.download_tags = false;
+	settings.update_fetchhead = false;
+	settings.refspecs.push_back("+refs/heads/*:" + pool_prefix + '*');
+
+	const bool fetched = pool.FetchUrl(remote_text_func, transfer_func, url, settings);
+	GetRepositoryInformation().transfer.Reset();
+
+	if (!fetched)
+	{
+		step_data.output << "Failed to fetch " << url << " into object pool\n";
+		return false;
+	}
+
+	// Repositories borrowing from the pool may still reference a force-pushed tip, a pool gc must not drop it
+	std::map<std::string, std::string> tips;
+	if (!pool.ListReferences(pool_prefix + '*', tips))
+		return false;
+
+	for (const auto& [name, previous_oid] : previous_tips)
+	{
+		const auto tip = tips.find(name);
+		if (tip != tips.end() && (tip->second == previous_oid || pool.IsDescendantOf(tip->second, previous_oid)))
+			continue;
+
+		const auto kept_reference = "refs/pool-kept/" + pool_namespace + '/' + previous_oid;
+		std::string kept_oid;
+		if (pool.GetReferenceTarget(kept_reference, kept_oid) && kept_oid.empty()
+			&& !pool.CompareAndSwapReference(kept_reference, "", previous_oid, "pool: keep rewritten tip"))
+		{
+			step_data.output << "Couldn't keep rewritten tip " << previous_oid << " of " << url << '\n';
+			return false;
+		}
+	}
+
+	step_data.output << "Fetched " << url << " into object pool\n";
+	return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Task.h"
+
+class GitLibLock;
+
+// Wires repositories to a shared bare repository through objects/info/alternates and fetches
+// every distinct remote URL into it once, so that repository fetches only move refs
+class ObjectPoolTask final : public Task
+{
+public:
+	explicit ObjectPoolTask(RepoOrchestrator* repo_orchestrator, StepData& step, const std::vector<const RepoConfig*>& repositories);
+
+	bool Run() override;
+	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
+
+private:
+	std::atomic<const char*> stage;
+	const std::vector<const RepoConfig*> repositories;
+
+	bool WireRepository(const RepoConfig& repository, const std::string& pool_objects, std::string& mirror_url, std::string& origin_url);
+	bool FetchIntoPool(GitLibLock& pool, const std::string& url);
+};
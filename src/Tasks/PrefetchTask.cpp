@@ -0,0 +1,161 @@
+#include "PrefetchTask.h"
+
+#include <vector>
+
+#include "Config.h"
+#include "GitLibLock.h"
+#include "ProcessLauncher.h"
+#include "RepoOrchestrator.h"
+#include "RunContext.h"
+
+namespace
+{
+	auto DefaultRemote = "origin";
+}
+
+PrefetchTask::PrefetchTask(RepoOrchestrator* repo_orchestrator, StepData& step) :
+	Task(repo_orchestrator, step),
+	stage("Preparing prefetch")
+{
+}
+
+bool PrefetchTask::Run()
+{
+	GitLibLock git;
+	const auto& config = GetConfig();
+
+	stage = "Opening repository";
+	if (!git.OpenRepo(config.path))
+	{
+		GetRepositoryInformation().is_repo_found = false;
+		step_data.error = "Couldn't find repository";
+		return false;
+	}
+	step_data.output << "Repository " << config.repo_name << " found" << '\n';
+
+	std::vector<std::string> remotes;
+	if (!config.local_repo.empty())
+		remotes.push_back(config.local_repo);
+	remotes.emplace_back(DefaultRemote);
+
+	bool any_prefetched = false;
+	for (const auto& remote : remotes)
+	{
+		TASK_RUNNER_CHECK;
+		if (PrefetchRemote(git, remote))
+			any_prefetched = true;
+	}
+
+	TASK_RUNNER_CHECK;
+
+	if (!any_prefetched)
+	{
+		step_data.error = "No remote could be prefetched";
+		return false;
+	}
+
+	stage = "Complete";
+	return true;
+}
+
+std::string_view PrefetchTask::GetCommand()
+{
+	return stage.load();
+}
+
+ResourceClass PrefetchTask::GetResourceClass() const
+{
+	return ResourceClass::Network;
+}
+
+bool PrefetchTask::PrefetchRemote(GitLibLock& git, const std::string& remote)
+{
+	stage = "Looking up remote";
+	if (!git.LookupRemote(remote))
+	{
+		step_data.output << "Failed to lookup remote " << remote << '\n';
+		return false;
+	}
+
+	std::string url;
+	if (!git.GetRemoteUrl(remote, url))
+	{
+		step_data.output << "Remote " << remote << " has no URL\n";
+		return false;
+	}
+
+	HostConnectionLimiter::Lease host_lease;
+	stage = "Waiting for a free connection to the remote host";
+	if (!GetRunContext().host_limiter.Acquire(url, should_stop, host_lease))
+		return false;
+
+	if (!GetConfig().fetch.filter.empty())
+		return PrefetchWithGitCli(remote);
+
+	std::function<int(const char*)> remote_text_func = [this](const char* str)
+	{
+		if (should_stop)
+			return -1;
+
+		step_data.output << "remote: " << str << '\n';
+		return 0;
+	};
+
+	TransferThrottle throttle(GetRunContext().bandwidth_limiter);
+	std::function<int(const TransferStats&)> transfer_func = [this, &throttle](const TransferStats& stats)
+	{
+		if (!throttle.Update(stats.received_bytes, should_stop))
+			return -1;
+
+		GetRepositoryInformation().transfer.Store(stats);
+		return 0;
+	};
+
+	// Same namespace as 'git maintenance run --task=prefetch'. Fetched by URL, a named remote would also
+	// update its configured refs/remotes/ tracking refs and prune them
+	GitFetchSettings settings;
+	settings.depth = GetConfig().fetch.depth;
+	settings.download_tags = false;
+	settings.update_fetchhead = false;
+	settings.refspecs.push_back("+refs/heads/*:refs/prefetch/remotes/" + remote + "/*");
+
+	stage = "Prefetching";
+	if (!git.FetchUrl(remote_text_func, transfer_func, url, settings))
+	{
+		GetRepositoryInformation().transfer.Reset();
+		step_data.output << "Failed to prefetch " << remote << '\n';
+		return false;
+	}
+
+	GetRepositoryInformation().transfer.Reset();
+	step_data.output << "Prefetched " << remote << '\n';
+	return true;
+}
+
+bool PrefetchTask::PrefetchWithGitCli(const std::string& remote)
+{
+	const auto& config = GetConfig();
+
+	std::stringstream command;
+	command << "git fetch --prefetch --no-prune --no-tags --no-write-fetch-head --recurse-submodules=no";
+	if (config.fetch.depth > 0)
+		command << " --depth=" << config.fetch.depth;
+	command << " --filter=" << config.fetch.filter << ' ' << remote;
+
+	stage = "Prefetching";
+
+	int exit_code = 255;
+	std::string error_log;
+	// Scheduled runs must not compete with the developer's work
+	const ResourceLimits background{ .scheduling = SchedulingClass::Idle };
+	LaunchWindowsApp(exit_code, step_data.output, error_log, command.str(), config.path, should_stop, {}, &background);
+
+	if (exit_code != 0)
+	{
+		step_data.output << "Failed to prefetch " << remote << " with git: " << error_log << '\n';
+		return false;
+	}
+
+	step_data.output << "Prefetched " << remote << '\n';
+	return true;
+}
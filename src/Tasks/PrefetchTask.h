@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+#include "Task.h"
+
+class GitLibLock;
+
+// Fetches every remote into refs/prefetch/, leaving remote-tracking refs and FETCH_HEAD untouched
+class PrefetchTask final : public Task
+{
+public:
+	explicit PrefetchTask(RepoOrchestrator* repo_orchestrator, StepData& step);
+
+	bool Run() override;
+	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
+
+private:
+	std::atomic<const char*> stage;
+
+	bool PrefetchRemote(GitLibLock& git, const std::string& remote);
+	bool PrefetchWithGitCli(const std::string& remote);
+};
@@ -1,8 +1,15 @@
 #include "PullPrepareTask.h"
 
+#include <charconv>
+#include <chrono>
+#include <thread>
+
 #include "Config.h"
+#include "FetchCoordinator.h"
 #include "GitLibLock.h"
+#include "ProcessLauncher.h"
 #include "RepoOrchestrator.h"
+#include "RunContext.h"
 
 enum class PullPrepareStatus : uint8_t
 {
@@ -18,6 +25,12 @@ enum class PullPrepareStatus : uint8_t
 	LocalConnect,
 	FetchingLocal,
 
+	CheckingAdvertised,
+
+	WaitingForShared,
+	FetchingShared,
+	WaitingForHost,
+
 	Comparing,
 	Complete,
 
@@ -75,6 +88,10 @@ namespace
 		case PullPrepareStatus::RemoteConnect: return "Connecting to remote repository";
 		case PullPrepareStatus::FetchingRemote: return "Fetching remote repository";
 
+		case PullPrepareStatus::CheckingAdvertised: return "Comparing advertised refs";
+		case PullPrepareStatus::WaitingForShared: return "Waiting for repository sharing the remote URL";
+		case PullPrepareStatus::FetchingShared: return "Fetching locally from repository sharing the remote URL";
+		case PullPrepareStatus::WaitingForHost: return "Waiting for a free connection to the remote host";
 		case PullPrepareStatus::Comparing: return "Comparing remote and local";
 		case PullPrepareStatus::Complete: return "Complete";
 		}
@@ -83,29 +100,129 @@ namespace
 	}
 
 	auto DefaultRemote = "origin";
+
+	int64_t MillisecondsSince(const std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	int64_t UnixTimeNow()
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	// Reads "Receiving objects:  45% (450/1000), 1.20 MiB | 2.00 MiB/s" and "Resolving deltas:  10% (10/100)"
+	// written by git fetch into the stats libgit2's indexer reports
+	struct GitProgress
+	{
+		TransferStats stats;
+
+		bool Parse(const std::string_view line)
+		{
+			const bool is_receiving = line.starts_with("Receiving objects:");
+			if (!is_receiving && !line.starts_with("Resolving deltas:"))
+				return false;
+
+			const auto open = line.find('(');
+			const auto slash = line.find('/', open);
+			const auto close = line.find(')', slash);
+			if (open == std::string_view::npos || slash == std::string_view::npos || close == std::string_view::npos)
+				return false;
+
+			unsigned done = 0, total = 0;
+			std::from_chars(line.data() + open + 1, line.data() + slash, done);
+			std::from_chars(line.data() + slash + 1, line.data() + close, total);
+
+			if (!is_receiving)
+			{
+				stats.indexed_deltas = done;
+				stats.total_deltas = total;
+				return true;
+			}
+
+			// index-pack indexes objects as they arrive
+			stats.received_objects = done;
+			stats.indexed_objects = done;
+			stats.total_objects = total;
+
+			// ", 1.20 MiB | 2.00 MiB/s"
+			const auto size_start = line.find_first_of("0123456789", close);
+			if (size_start == std::string_view::npos)
+				return true;
+
+			double size = 0;
+			const auto [unit_start, error] = std::from_chars(line.data() + size_start, line.data() + line.size(), size);
+			if (error != std::errc{})
+				return true;
+
+			const std::string_view unit{ unit_start, static_cast<size_t>(line.data() + line.size() - unit_start) };
+			if (unit.starts_with(" GiB"))
+				size *= 1024. * 1024. * 1024.;
+			else if (unit.starts_with(" MiB"))
+				size *= 1024. * 1024.;
+			else if (unit.starts_with(" KiB"))
+				size *= 1024.;
+			stats.received_bytes = static_cast<size_t>(size);
+			return true;
+		}
+	};
 }
 
 PullPrepareTask::PullPrepareTask(RepoOrchestrator* repo_orchestrator, StepData& step) :
+	PullPrepareTask(repo_orchestrator, step, false)
+{
+}
+
+PullPrepareTask::PullPrepareTask(RepoOrchestrator* repo_orchestrator, StepData& step, const bool advertisement_only) :
 	Task(repo_orchestrator, step),
-	status(PullPrepareStatus::Preparing)
+	status(PullPrepareStatus::Preparing),
+	advertisement_only(advertisement_only)
 {
 }
 
 bool PullPrepareTask::Run()
 {
 	GitLibLock git;
+	connect_sample = {};
 
 	if (!Prepare(git))
 		return false;
 
 	const auto& config = GetConfig();
-	bool local_status = false;
+
+	struct RemoteFetch
+	{
+		std::string name;
+		PullPrepareStatus remote_enum;
+		bool status = false;
+	};
+
+	// Mirror goes first unless origin answered faster in previous runs
+	std::vector<RemoteFetch> remotes;
 	if (!config.local_repo.empty())
-		local_status = FetchRemote(git, config.local_repo, PullPrepareStatus::RemoteLocal);
-	TASK_RUNNER_CHECK;
+		remotes.push_back({ config.local_repo, PullPrepareStatus::RemoteLocal });
+	remotes.push_back({ DefaultRemote, PullPrepareStatus::RemoteStandard });
 
-	const bool remote_status = FetchRemote(git, DefaultRemote, PullPrepareStatus::RemoteStandard);
-	TASK_RUNNER_CHECK;
+	if (remotes.size() > 1 && IsFasterRemote(remotes[1].name, remotes[0].name))
+		std::swap(remotes[0], remotes[1]);
+
+	// Later remotes only have to provide what the earlier ones didn't
+	bool any_fetched = false;
+	for (auto& remote : remotes)
+	{
+		remote.status = FetchRemote(git, remote.name, remote.remote_enum, any_fetched);
+		any_fetched |= remote.status;
+		TASK_RUNNER_CHECK;
+	}
+
+	bool local_status = false;
+	bool remote_status = false;
+	for (const auto& remote : remotes)
+	{
+		if (remote.remote_enum == PullPrepareStatus::RemoteLocal)
+			local_status = remote.status;
+		else remote_status = remote.status;
+	}
 
 	if (!local_status && !remote_status)
 	{
@@ -129,6 +246,17 @@ std::string_view PullPrepareTask::GetCommand()
 	return ToString(status);
 }
 
+ResourceClass PullPrepareTask::GetResourceClass() const
+{
+	return ResourceClass::Network;
+}
+
+// Handshake time depends on the host and the network, not on how much there is to download
+LatencySample PullPrepareTask::GetLatencySample() const
+{
+	return connect_sample;
+}
+
 // ReSharper disable once CppMemberFunctionMayBeConst
 int PullPrepareTask::FetchRemoteCommand(const char* str)
 {
@@ -139,19 +267,63 @@ int PullPrepareTask::FetchRemoteCommand(const char* str)
 	return 0;
 }
 
-// ReSharper disable once CppMemberFunctionMayBeConst
-int PullPrepareTask::FetchTransferCommand(const unsigned processed, const unsigned total, const size_t bytes)
+// Called for every libgit2 progress update, only milestones reach the text log
+int PullPrepareTask::FetchTransferCommand(const TransferStats& stats)
 {
 	if (should_stop)
 		return -1;
 
-	step_data.output << "Processed: "
-		<< processed << " / "<< total
-		<< " (" << 100.f * (static_cast<float>(processed) / static_cast<float>(total)) << "): "
-		<< bytes << "bytes" << '\n';
+	// Object count is known from the pack header, long before the pack is downloaded
+	if (is_handover_armed && stats.total_objects > GetConfig().fetch.cli_object_threshold)
+	{
+		is_handed_over = true;
+		return -1;
+	}
+
+	if (throttle && !throttle->Update(stats.received_bytes, should_stop))
+		return -1;
+
+	GetRepositoryInformation().transfer.Store(stats);
+
+	if (stats.total_objects > 0)
+	{
+		const auto quarters = static_cast<unsigned>(4ull * stats.received_objects / stats.total_objects);
+		if (quarters > logged_quarters)
+		{
+			logged_quarters = quarters;
+			step_data.output << "Received " << quarters * 25 << "% of objects (" << stats.received_objects << " / "
+				<< stats.total_objects << ", " << stats.received_bytes / 1024 << " KiB)\n";
+		}
+	}
+
+	if (!are_deltas_logged && stats.total_deltas > 0 && stats.indexed_deltas == stats.total_deltas)
+	{
+		are_deltas_logged = true;
+		step_data.output << "Resolved " << stats.total_deltas << " deltas\n";
+	}
+
 	return 0;
 }
 
+void PullPrepareTask::ResetTransfer()
+{
+	GetRepositoryInformation().transfer.Reset();
+	throttle.reset();
+	logged_quarters = 0;
+	are_deltas_logged = false;
+}
+
+bool PullPrepareTask::AcquireHostConnection(GitLibLock& git, const std::string_view& remote, HostConnectionLimiter::Lease& lease)
+{
+	// Lookup failures are reported by the connect that follows
+	std::string url;
+	if (!git.GetRemoteUrl(remote, url))
+		return true;
+
+	status = PullPrepareStatus::WaitingForHost;
+	return GetRunContext().host_limiter.Acquire(url, should_stop, lease);
+}
+
 bool PullPrepareTask::Prepare(GitLibLock& git)
 {
 	auto& info = GetRepositoryInformation();
@@ -184,46 +356,75 @@ bool PullPrepareTask::Prepare(GitLibLock& git)
 
 	step_data.output << "Current branch is " << info.current_branch << '\n';
 
+	if (!git.GetUpstreamBranch(info.current_branch, current_upstream))
+	{
+		step_data.error = "Couldn't read upstream of " + info.current_branch;
+		return false;
+	}
+
 	return true;
 }
 
-bool PullPrepareTask::FetchRemote(GitLibLock& git, const std::string_view& remote, const PullPrepareStatus remote_enum)
+bool PullPrepareTask::FetchRemote(GitLibLock& git, const std::string_view& remote, const PullPrepareStatus remote_enum, const bool is_complement)
 {
-	std::function<int(const char*)> remote_text_func = [this](const char* str)
-	{
-		return FetchRemoteCommand(str);
-	};
-
-	std::function<int(unsigned, unsigned, size_t)> transfer_func = [this](const unsigned processed, const unsigned total, const size_t bytes)
-	{
-		return FetchTransferCommand(processed, total, bytes);
-	};
-
 	if (!remote.empty())
 	{
 		status = remote_enum;
 
+		auto& last_fetch_times = GetRepositoryInformation().last_fetch_times;
+		const auto ttl_seconds = GetConfig().fetch.ttl_seconds;
+
+		// Remote-tracking refs are recent enough, compare against them as they are
+		if (!advertisement_only && ttl_seconds > 0)
+		{
+			const auto last_fetch = last_fetch_times.find(std::string{ remote });
+			if (last_fetch != last_fetch_times.end() && UnixTimeNow() - last_fetch->second < ttl_seconds)
+			{
+				step_data.output << "Remote " << remote << " fetched " << UnixTimeNow() - last_fetch->second << " s ago, skipping fetch\n";
+				return true;
+			}
+		}
+
 		if (git.LookupRemote(remote))
 		{
 			step_data.output << "Remote " << remote << " found\n";
 
 			TASK_RUNNER_CHECK;
-			status = PpsConnect(remote_enum);
 
-			if (git.ConnectToRemote(remote))
+			// libgit2 can't fetch with a partial clone filter
+			if (!advertisement_only && !GetConfig().fetch.filter.empty())
 			{
-				step_data.output << "Connected to repository " << remote << '\n';
+				HostConnectionLimiter::Lease host_lease;
+				if (!AcquireHostConnection(git, remote, host_lease))
+					return false;
 
-				TASK_RUNNER_CHECK;
 				status = PpsFetching(remote_enum);
+				if (!FetchWithGitCli(remote))
+					return false;
+
+				last_fetch_times[std::string{ remote }] = UnixTimeNow();
+				return true;
+			}
 
-				if (git.Fetch(remote_text_func, transfer_func, remote))
+			// The first repository to claim a URL fetches it over the network, the rest copy from it
+			std::string url;
+			if (!advertisement_only && GetConfig().fetch.depth == 0 && git.GetRemoteUrl(remote, url))
+			{
+				auto& coordinator = GetRunContext().fetch_coordinator;
+				if (coordinator.Claim(url, { GetConfig().path, std::string{ remote }, GetConfig().repo_name }))
 				{
-					step_data.output << "Fetched data from repository " << remote << '\n';
-					return true;
+					const bool fetched = FetchOverNetwork(git, remote, remote_enum, is_complement);
+					coordinator.Complete(url, fetched);
+					return fetched;
 				}
+
+				if (FetchFromShared(git, remote, url))
+					return true;
+
+				TASK_RUNNER_CHECK;
 			}
-			else step_data.output << "Failed to connect to remote " << remote << '\n';
+
+			return FetchOverNetwork(git, remote, remote_enum, is_complement);
 		}
 		else step_data.output << "Failed to lookup remote " << remote << '\n';
 	}
@@ -231,6 +432,294 @@ bool PullPrepareTask::FetchRemote(GitLibLock& git, const std::string_view& remot
 	return false;
 }
 
+bool PullPrepareTask::FetchOverNetwork(GitLibLock& git, const std::string_view& remote, const PullPrepareStatus remote_enum, const bool is_complement)
+{
+	std::function<int(const char*)> remote_text_func = [this](const char* str)
+	{
+		return FetchRemoteCommand(str);
+	};
+
+	std::function<int(const TransferStats&)> transfer_func = [this](const TransferStats& stats)
+	{
+		return FetchTransferCommand(stats);
+	};
+
+	// Held until the fetch is done, including a handover to git
+	HostConnectionLimiter::Lease host_lease;
+	if (!AcquireHostConnection(git, remote, host_lease))
+		return false;
+
+	status = PpsConnect(remote_enum);
+
+	const auto connect_start = std::chrono::steady_clock::now();
+	if (!git.ConnectToRemote(remote))
+	{
+		step_data.output << "Failed to connect to remote " << remote << '\n';
+		return false;
+	}
+
+	const auto connect_ms = MillisecondsSince(connect_start);
+	auto& connect_time = GetRepositoryInformation().connect_times[std::string{ remote }];
+	if (connect_time > 0 && connect_ms - connect_time > connect_sample.measured_ms - connect_sample.expected_ms)
+		connect_sample = { connect_ms, connect_time };
+	connect_time = connect_ms;
+	step_data.output << "Connected to repository " << remote << " in " << connect_ms << " ms\n";
+
+	TASK_RUNNER_CHECK;
+
+	if (advertisement_only)
+	{
+		status = PullPrepareStatus::CheckingAdvertised;
+
+		bool has_incoming = false;
+		if (git.HasAdvertisedIncoming(remote, has_incoming))
+		{
+			step_data.output << "Compared advertised refs of " << remote << (has_incoming ? ": incoming changes\n" : ": up to date\n");
+			has_advertised_incoming |= has_incoming;
+			return true;
+		}
+
+		step_data.output << "Failed to compare advertised refs of " << remote << '\n';
+		return false;
+	}
+
+	auto fetch_settings = GetFetchSettings(remote);
+
+	// Branches the previous remote already brought in only need their remote-tracking refs moved,
+	// the download is narrowed to the rest or skipped when nothing is left
+	std::vector<std::string> missing_refspecs;
+	if (is_complement && git.UpdatePresentAdvertised(remote, fetch_settings, missing_refspecs))
+	{
+		if (missing_refspecs.empty())
+		{
+			step_data.output << "All branches of " << remote << " already present, updated refs only\n";
+			GetRepositoryInformation().last_fetch_times[std::string{ remote }] = UnixTimeNow();
+			return true;
+		}
+
+		step_data.output << missing_refspecs.size() << " branches of " << remote << " not present yet, fetching only those\n";
+		fetch_settings.refspecs = std::move(missing_refspecs);
+	}
+
+	status = PpsFetching(remote_enum);
+
+	// git can't be throttled, its progress output is far too sparse to back the download up
+	is_handover_armed = GetConfig().fetch.cli_object_threshold > 0 && GetRunContext().bandwidth_limiter.GetLimit() == 0;
+	is_handed_over = false;
+
+	ResetTransfer();
+	throttle = std::make_unique<TransferThrottle>(GetRunContext().bandwidth_limiter);
+	const auto fetch_start = std::chrono::steady_clock::now();
+	const bool fetched = git.Fetch(remote_text_func, transfer_func, remote, fetch_settings);
+	is_handover_armed = false;
+	ResetTransfer();
+
+	if (is_handed_over)
+	{
+		step_data.output << "Pack of " << remote << " has more than " << GetConfig().fetch.cli_object_threshold << " objects, fetching it with git\n";
+		if (!FetchWithGitCli(remote))
+			return false;
+
+		GetRepositoryInformation().last_fetch_times[std::string{ remote }] = UnixTimeNow();
+		return true;
+	}
+
+	if (!fetched)
+		return false;
+
+	step_data.output << "Fetched data from repository " << remote << " in " << MillisecondsSince(fetch_start) << " ms\n";
+	GetRepositoryInformation().last_fetch_times[std::string{ remote }] = UnixTimeNow();
+	return true;
+}
+
+// Maps remote-tracking refs of the repository that fetched url onto this repository's remote
+bool PullPrepareTask::FetchFromShared(GitLibLock& git, const std::string_view& remote, const std::string& url)
+{
+	status = PullPrepareStatus::WaitingForShared;
+
+	// Pool and adaptive slots go to fetches that can run meanwhile
+	SuspendStep();
+	FetchCoordinator::Source source;
+	const bool is_shared = GetRunContext().fetch_coordinator.WaitFor(url, should_stop, source);
+	if (!ResumeStep())
+		return false;
+
+	if (!is_shared)
+	{
+		step_data.output << "Shared fetch of " << url << " failed, fetching it directly\n";
+		return false;
+	}
+
+	// Same repository listing the URL under two remote names
+	if (source.path == GetConfig().path)
+		return false;
+
+	std::function<int(const char*)> remote_text_func = [this](const char* str)
+	{
+		return FetchRemoteCommand(str);
+	};
+
+	std::function<int(const TransferStats&)> transfer_func = [this](const TransferStats& stats)
+	{
+		return FetchTransferCommand(stats);
+	};
+
+	status = PullPrepareStatus::FetchingShared;
+
+	const auto source_prefix = "+refs/remotes/" + source.remote_name + '/';
+	const auto target_prefix = "refs/remotes/" + std::string{ remote } + '/';
+
+	GitFetchSettings settings;
+	settings.download_tags = GetConfig().fetch.tags;
+
+	const auto branches = GetFetchedBranches();
+	if (branches.empty())
+		settings.refspecs.push_back(source_prefix + "*:" + target_prefix + '*');
+	for (const auto& branch : branches)
+		settings.refspecs.push_back(source_prefix + branch + ':' + target_prefix + branch);
+
+	ResetTransfer();
+	const auto fetch_start = std::chrono::steady_clock::now();
+	const bool fetched = git.FetchUrl(remote_text_func, transfer_func, source.path, settings);
+	ResetTransfer();
+
+	if (!fetched)
+	{
+		step_data.output << "Failed to fetch " << remote << " locally from " << source.repo_name << '\n';
+		return false;
+	}
+
+	// The source may have fetched other branches than the ones pull needs here, or failed to update some
+	GitLibLock source_git;
+	if (!source_git.OpenRepo(source.path))
+		return false;
+
+	for (const auto& branch : GetPulledBranches())
+	{
+		std::string source_oid, oid;
+		if (!source_git.GetReferenceTarget("refs/remotes/" + source.remote_name + '/' + branch, source_oid)
+			|| !git.GetReferenceTarget(target_prefix + branch, oid)
+			|| source_oid.empty() || oid != source_oid)
+		{
+			step_data.output << "Branch " << branch << " of " << remote << " wasn't updated from " << source.repo_name << ", fetching it directly\n";
+			return false;
+		}
+	}
+
+	step_data.output << "Fetched " << remote << " locally from " << source.repo_name << " in " << MillisecondsSince(fetch_start) << " ms\n";
+
+	auto& info = GetRepositoryInformation();
+	info.last_fetch_times[std::string{ remote }] = UnixTimeNow();
+	info.fetched_from = source.repo_name;
+	info.is_fetched_locally = true;
+	return true;
+}
+
+bool PullPrepareTask::FetchWithGitCli(const std::string_view& remote)
+{
+	const auto& config = GetConfig();
+	const auto fetch_settings = GetFetchSettings(remote);
+
+	// index-pack caps itself at 3 threads unless told otherwise
+	// First filtered fetch registers the remote as promisor and enables extensions.partialclone
+	std::stringstream command;
+	command << "git -c pack.threads=" << std::max<unsigned>(std::thread::hardware_concurrency(), 1) << " fetch --progress";
+	if (fetch_settings.depth > 0)
+		command << " --depth=" << fetch_settings.depth;
+	if (!config.fetch.filter.empty())
+		command << " --filter=" << config.fetch.filter;
+	if (!fetch_settings.download_tags)
+		command << " --no-tags";
+	command << ' ' << remote;
+	for (const auto& refspec : fetch_settings.refspecs)
+		command << ' ' << refspec;
+
+	// Progress lines are rewritten in place with '\r', they go to the same counters libgit2 feeds
+	GitProgress progress;
+	std::string line;
+	const auto parse_output = [this, &progress, &line](const std::string_view chunk)
+	{
+		for (const char c : chunk)
+		{
+			if (c != '\r' && c != '\n')
+			{
+				line.push_back(c);
+				continue;
+			}
+
+			if (progress.Parse(line))
+				FetchTransferCommand(progress.stats);
+			else if (c == '\n' && !line.empty())
+				step_data.output << line << '\n';
+			line.clear();
+		}
+	};
+
+	int exit_code = 255;
+	std::string error_log;
+	// Not throttled, sleeping on the progress pipe doesn't slow git's download
+	ResetTransfer();
+	const auto fetch_start = std::chrono::steady_clock::now();
+	LaunchWindowsApp(exit_code, step_data.output, error_log, command.str(), config.path, should_stop, parse_output);
+	ResetTransfer();
+
+	if (exit_code != 0)
+	{
+		step_data.output << "Failed to fetch " << remote << " with git: " << error_log << '\n';
+		return false;
+	}
+
+	step_data.output << "Fetched data from repository " << remote << " in " << MillisecondsSince(fetch_start) << " ms\n";
+	return true;
+}
+
+GitFetchSettings PullPrepareTask::GetFetchSettings(const std::string_view& remote) const
+{
+	const auto& config = GetConfig();
+
+	GitFetchSettings settings;
+	settings.depth = config.fetch.depth;
+	settings.download_tags = config.fetch.tags;
+
+	for (const auto& branch : GetFetchedBranches())
+		settings.refspecs.push_back("+refs/heads/" + branch + ":refs/remotes/" + std::string{ remote } + '/' + branch);
+
+	return settings;
+}
+
+std::vector<std::string> PullPrepareTask::GetFetchedBranches() const
+{
+	if (!GetConfig().fetch.narrow)
+		return {};
+
+	return GetPulledBranches();
+}
+
+// Pull only looks at these two branches, named as on the remote.
+// A local-only current branch has nothing to fetch, asking git for it would fail the whole fetch.
+std::vector<std::string> PullPrepareTask::GetPulledBranches() const
+{
+	const auto& config = GetConfig();
+	std::vector<std::string> branches{ config.default_branch };
+	if (!current_upstream.empty() && current_upstream != config.default_branch)
+		branches.push_back(current_upstream);
+
+	return branches;
+}
+
+bool PullPrepareTask::IsFasterRemote(const std::string& remote, const std::string& other) const
+{
+	const auto& connect_times = GetRepositoryInformation().connect_times;
+	const auto remote_it = connect_times.find(remote);
+	const auto other_it = connect_times.find(other);
+
+	// Without history for both the configured order stays
+	if (remote_it == connect_times.end() || other_it == connect_times.end())
+		return false;
+
+	return remote_it->second < other_it->second;
+}
+
 bool PullPrepareTask::Compare(GitLibLock& git)
 {
 	status = PullPrepareStatus::Comparing;
@@ -250,7 +739,7 @@ bool PullPrepareTask::Compare(GitLibLock& git)
 
 	TASK_RUNNER_CHECK;
 
-	if (git.HasIncoming())
+	if (git.HasIncoming() || has_advertised_incoming)
 		info.has_incoming = true;
 	else return true; // nothing is incoming, we won't modify it anyway
 
@@ -265,6 +754,11 @@ bool PullPrepareTask::Compare(GitLibLock& git)
 	return true;
 }
 
+PullCheckTask::PullCheckTask(RepoOrchestrator* repo_orchestrator, StepData& step) :
+	PullPrepareTask(repo_orchestrator, step, true)
+{
+}
+
 SubmodulePullPrepareTask::SubmodulePullPrepareTask(RepoOrchestrator* repo_orchestrator, StepData& step,
 	const RepoConfig& submodule_config, RepositoryInformation& submodule_information) :
 	PullPrepareTask(repo_orchestrator, step),
@@ -1,11 +1,16 @@
 #pragma once
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "NetworkLimits.h"
 #include "Task.h"
 
 struct RepoConfig;
 struct RepositoryInformation;
 class GitLibLock;
+struct GitFetchSettings;
+struct TransferStats;
 enum class PullPrepareStatus : uint8_t;
 
 class PullPrepareTask : public Task
@@ -15,19 +20,57 @@ public:
 
 	bool Run() override;
 	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
+	LatencySample GetLatencySample() const override;
 
 	// internal
 	int FetchRemoteCommand(const char* str);
-	int FetchTransferCommand(unsigned processed, unsigned total, size_t bytes);
+	int FetchTransferCommand(const TransferStats& stats);
+
+protected:
+	explicit PullPrepareTask(RepoOrchestrator* repo_orchestrator, StepData& step, bool advertisement_only);
 
 private:
 	PullPrepareStatus status;
 
+	// Compares advertised refs instead of downloading packs
+	const bool advertisement_only;
+	bool has_advertised_incoming = false;
+	// Slowest connect of this run relative to the remote's stored connect time
+	LatencySample connect_sample;
+	// Remote branch the current branch pulls from, empty for a local-only branch
+	std::string current_upstream;
+	// Set while libgit2 fetches a pack that may turn out too large for its single threaded indexer
+	bool is_handover_armed = false;
+	bool is_handed_over = false;
+
+	// Progress milestones already written to the output of the current fetch
+	unsigned logged_quarters = 0;
+	bool are_deltas_logged = false;
+	// Set while the current fetch goes over the network
+	std::unique_ptr<TransferThrottle> throttle;
+
+	void ResetTransfer();
+	bool AcquireHostConnection(GitLibLock& git, const std::string_view& remote, HostConnectionLimiter::Lease& lease);
+
 	bool Prepare(GitLibLock& git);
-	bool FetchRemote(GitLibLock& git, const std::string_view& remote, const PullPrepareStatus remote_enum);
+	bool FetchRemote(GitLibLock& git, const std::string_view& remote, const PullPrepareStatus remote_enum, bool is_complement);
+	bool FetchOverNetwork(GitLibLock& git, const std::string_view& remote, const PullPrepareStatus remote_enum, bool is_complement);
+	bool FetchFromShared(GitLibLock& git, const std::string_view& remote, const std::string& url);
+	bool FetchWithGitCli(const std::string_view& remote);
+	GitFetchSettings GetFetchSettings(const std::string_view& remote) const;
+	std::vector<std::string> GetFetchedBranches() const;
+	std::vector<std::string> GetPulledBranches() const;
+	bool IsFasterRemote(const std::string& remote, const std::string& other) const;
 	bool Compare(GitLibLock& git);
 };
 
+class PullCheckTask final : public PullPrepareTask
+{
+public:
+	explicit PullCheckTask(RepoOrchestrator* repo_orchestrator, StepData& step);
+};
+
 class SubmodulePullPrepareTask final : public PullPrepareTask
 {
 public:
@@ -1,6 +1,8 @@
 #include "PullTask.h"
 
 #include "Config.h"
+#include "GitLibLock.h"
+#include "PushTask.h"
 #include "RepoOrchestrator.h"
 
 namespace
@@ -19,6 +21,11 @@ std::string_view PullTask::GetCommand()
 	return "Pulling...";
 }
 
+ResourceClass PullTask::GetResourceClass() const
+{
+	return ResourceClass::Network;
+}
+
 TargetedPullTask::TargetedPullTask(RepoOrchestrator* repo_orchestrator, StepData& step, const RepoConfig& repo_config) :
 	PullTask(repo_orchestrator, step),
 	targeted_config(repo_config)
@@ -35,7 +42,28 @@ LocalPullTask::LocalPullTask(RepoOrchestrator* repo_orchestrator, StepData& step
 {
 }
 
+// Runs ahead of the pulls, so the snapshot tells PushLocalTask which object files came with them
+bool LocalPullTask::Run()
+{
+	auto& objects_before_pull = GetRepositoryInformation().objects_before_pull;
+	objects_before_pull.reset();
+
+	GitLibLock git;
+	std::vector<std::filesystem::path> directories;
+	if (git.OpenRepo(GetConfig().path) && git.GetObjectDirectories(directories))
+		objects_before_pull = PushLocalTask::ListObjectFiles(directories.front());
+
+	TASK_RUNNER_CHECK;
+
+	return CommandTask::Run();
+}
+
 std::string_view LocalPullTask::GetCommand()
 {
 	return "Pulling local...";
 }
+
+ResourceClass LocalPullTask::GetResourceClass() const
+{
+	return ResourceClass::Disk;
+}
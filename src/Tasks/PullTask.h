@@ -7,6 +7,7 @@ public:
 	explicit PullTask(RepoOrchestrator* repo_orchestrator, StepData& step);
 
 	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
 };
 
 class TargetedPullTask final : public PullTask
@@ -26,5 +27,7 @@ class LocalPullTask : public CommandTask
 public:
 	explicit LocalPullTask(RepoOrchestrator* repo_orchestrator, StepData& step);
 
+	bool Run() override;
 	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
 };
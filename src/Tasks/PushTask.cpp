@@ -1,11 +1,51 @@
 #include "PushTask.h"
 
+#include <algorithm>
+#include <cctype>
+
 #include "Config.h"
+#include "GitLibLock.h"
 #include "RepoOrchestrator.h"
 
 namespace
 {
-	constexpr auto PushCommand = "git push local ";
+	constexpr auto LocalRemote = "local";
+	const std::string PushCommand = std::string{ "git push " } + LocalRemote + ' ';
+
+	// Empty when the url doesn't name a directory on this machine
+	std::filesystem::path GetLocalPath(std::string url)
+	{
+		constexpr std::string_view file_scheme = "file://";
+		if (url.starts_with(file_scheme))
+			url.erase(0, file_scheme.size());
+
+		std::error_code error_code;
+		if (!std::filesystem::is_directory(url, error_code))
+			return {};
+
+		return url;
+	}
+
+	bool IsLooseObjectDirectory(const std::filesystem::path& path)
+	{
+		const auto name = path.filename().string();
+		return name.size() == 2 && std::ranges::all_of(name, [](const char c) { return std::isxdigit(static_cast<unsigned char>(c)); });
+	}
+
+	// Already existing files are identical, object and pack names are their content hashes
+	bool LinkFile(const std::filesystem::path& source, const std::filesystem::path& target, size_t& linked)
+	{
+		std::error_code error_code;
+		if (exists(target, error_code))
+			return true;
+
+		create_hard_link(source, target, error_code);
+		if (error_code && error_code != std::errc::file_exists)
+			return false;
+
+		++linked;
+		return true;
+	}
 }
 
 PushLocalTask::PushLocalTask(RepoOrchestrator* repo_orchestrator, StepData& step) :
@@ -13,7 +53,177 @@ PushLocalTask::PushLocalTask(RepoOrchestrator* repo_orchestrator, StepData& step
 {
 }
 
+bool PushLocalTask::Run()
+{
+	switch (LinkPush())
+	{
+	case LinkPushResult::Pushed:
+		return true;
+	case LinkPushResult::Failed:
+		return false;
+	case LinkPushResult::Fallback:
+		break;
+	}
+
+	TASK_RUNNER_CHECK;
+
+	return CommandTask::Run();
+}
+
 std::string_view PushLocalTask::GetCommand()
 {
 	return "Updating local repo";
 }
+
+ResourceClass PushLocalTask::GetResourceClass() const
+{
+	return ResourceClass::Disk;
+}
+
+// Links new packs and loose objects into the mirror instead of generating a pack for it,
+// then moves the mirror branch only if nobody else moved it meanwhile
+PushLocalTask::LinkPushResult PushLocalTask::LinkPush()
+{
+	const auto& config = GetConfig();
+	const auto branch_reference = "refs/heads/" + config.default_branch;
+
+	GitLibLock git;
+	std::string mirror_url;
+	if (!git.OpenRepo(config.path) || !git.GetRemoteUrl(LocalRemote, mirror_url))
+		return LinkPushResult::Fallback;
+
+	GitLibLock mirror;
+	const auto mirror_path = GetLocalPath(mirror_url);
+	if (mirror_path.empty() || !mirror.OpenRepo(mirror_path.string()))
+	{
+		step_data.output << "Mirror " << mirror_url << " isn't a local repository, pushing with git\n";
+		return LinkPushResult::Fallback;
+	}
+
+	std::string new_oid, old_oid;
+	if (!git.GetReferenceTarget(branch_reference, new_oid) || new_oid.empty() || !mirror.GetReferenceTarget(branch_reference, old_oid))
+		return LinkPushResult::Fallback;
+
+	if (new_oid == old_oid)
+	{
+		step_data.output << "Mirror " << config.default_branch << " already at " << new_oid << '\n';
+		return LinkPushResult::Pushed;
+	}
+
+	// Same rule as push without --force
+	if (!old_oid.empty() && !(git.HasObject(old_oid) && git.IsDescendantOf(new_oid, old_oid)))
+	{
+		step_data.error = "Mirror " + config.default_branch + " at " + old_oid + " can't be fast-forwarded to " + new_oid;
+		return LinkPushResult::Failed;
+	}
+
+	if (should_stop)
+		return LinkPushResult::Failed;
+
+	size_t linked = 0;
+	if (!mirror.HasObject(new_oid))
+	{
+		std::vector<std::filesystem::path> sources, targets;
+		if (!git.GetObjectDirectories(sources) || !mirror.GetObjectDirectories(targets))
+			return LinkPushResult::Fallback;
+
+		// Without a snapshot from before the pull every object file is a candidate
+		const auto& objects_before_pull = GetRepositoryInformation().objects_before_pull;
+		if (!LinkObjects(sources.front(), targets.front(), objects_before_pull ? *objects_before_pull : std::set<std::string>{}, linked))
+		{
+			step_data.output << "Couldn't hardlink objects into mirror, pushing with git\n";
+			return LinkPushResult::Fallback;
+		}
+	}
+
+	if (should_stop)
+		return LinkPushResult::Failed;
+
+	// Local commits made before the pull aren't linked, and objects borrowed from alternates such as the
+	// object pool never are - the mirror is shared and mustn't come to depend on them. git push sends those.
+	if (!mirror.IsConnected(new_oid, old_oid))
+	{
+		step_data.output << "Mirror is missing objects of " << new_oid << ", pushing with git\n";
+		return LinkPushResult::Fallback;
+	}
+
+	if (!mirror.CompareAndSwapReference(branch_reference, old_oid, new_oid, "push: fast-forward"))
+	{
+		step_data.error = "Mirror " + config.default_branch + " moved while updating it";
+		return LinkPushResult::Failed;
+	}
+
+	// Remote-tracking ref follows the pushed branch, same as git push
+	const auto tracking_reference = std::string{ "refs/remotes/" } + LocalRemote + '/' + config.default_branch;
+	std::string tracking_oid;
+	if (git.GetReferenceTarget(tracking_reference, tracking_oid))
+		git.CompareAndSwapReference(tracking_reference, tracking_oid, new_oid, "update by push");
+
+	step_data.output << "Linked " << linked << " files, mirror " << config.default_branch << " moved from "
+		<< (old_oid.empty() ? "nothing" : old_oid) << " to " << new_oid << '\n';
+	return LinkPushResult::Pushed;
+}
+
+std::set<std::string> PushLocalTask::ListObjectFiles(const std::filesystem::path& objects)
+{
+	std::set<std::string> files;
+	std::error_code error_code;
+
+	for (const auto& entry : std::filesystem::directory_iterator(objects / "pack", error_code))
+		if (entry.path().extension() == ".pack")
+			files.insert("pack/" + entry.path().filename().string());
+
+	for (const auto& directory : std::filesystem::directory_iterator(objects, error_code))
+	{
+		if (!directory.is_directory() || !IsLooseObjectDirectory(directory.path()))
+			continue;
+
+		const auto prefix = directory.path().filename().string() + '/';
+		for (const auto& object : std::filesystem::directory_iterator(directory.path(), error_code))
+			files.insert(prefix + object.path().filename().string());
+	}
+
+	return files;
+}
+
+// Files in skipped were there before the pull, whatever the mirror still lacks from them is left to git push
+bool PushLocalTask::LinkObjects(const std::filesystem::path& source, const std::filesystem::path& target,
+	const std::set<std::string>& skipped, size_t& linked)
+{
+	std::error_code error_code;
+
+	const auto files = ListObjectFiles(source);
+	for (const auto& file : files)
+	{
+		if (skipped.contains(file))
+			continue;
+
+		const auto source_file = source / file;
+		const auto target_file = target / file;
+		create_directories(target_file.parent_path(), error_code);
+
+		if (source_file.extension() != ".pack")
+		{
+			if (!LinkFile(source_file, target_file, linked))
+				return false;
+			continue;
+		}
+
+		// Index is linked last, a pack becomes visible to readers once its index exists
+		auto source_pack = source_file;
+		for (const auto* extension : { ".pack", ".rev", ".idx" })
+		{
+			source_pack.replace_extension(extension);
+			if (extension != std::string_view{ ".pack" } && !exists(source_pack, error_code))
+				continue;
+
+			if (!LinkFile(source_pack, target_file.parent_path() / source_pack.filename(), linked))
+				return false;
+		}
+
+		if (should_stop)
+			return false;
+	}
+
+	return true;
+}
@@ -1,10 +1,35 @@
 #pragma once
+#include <filesystem>
+#include <set>
+#include <vector>
+
 #include "CommandTask.h"
 
+class GitLibLock;
+
+// Fast-forwards the mirror in process when it is a repository on the same volume,
+// falls back to git push otherwise
 class PushLocalTask final : public CommandTask
 {
 public:
 	explicit PushLocalTask(RepoOrchestrator* repo_orchestrator, StepData& step);
 
+	bool Run() override;
 	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
+
+	// Pack and loose object files of an objects directory, relative to it
+	static std::set<std::string> ListObjectFiles(const std::filesystem::path& objects);
+
+private:
+	enum class LinkPushResult : uint8_t
+	{
+		Pushed,
+		Fallback,
+		Failed,
+	};
+
+	LinkPushResult LinkPush();
+	bool LinkObjects(const std::filesystem::path& source, const std::filesystem::path& target,
+		const std::set<std::string>& skipped, size_t& linked);
 };
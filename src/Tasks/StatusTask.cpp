@@ -1,21 +1,37 @@
 #include "StatusTask.h"
 
+#include <chrono>
 #include <Config.h>
 #include <GitLibLock.h>
 
 #include "RepoOrchestrator.h"
 
+namespace
+{
+	// Badly diverged branches are reported as "N+" instead of stalling the table
+	constexpr size_t AheadBehindWalkLimit = 10000;
+}
+
 StatusTask::StatusTask(RepoOrchestrator* repo_orchestrator, StepData& step) :
-	Task(repo_orchestrator, step)
+	StatusTask(repo_orchestrator, step, false)
+{
+}
+
+StatusTask::StatusTask(RepoOrchestrator* repo_orchestrator, StepData& step, const bool stop_on_dirty) :
+	Task(repo_orchestrator, step),
+	stop_on_dirty(stop_on_dirty)
 {
 }
 
 bool StatusTask::Run()
 {
+    const auto scan_start = std::chrono::steady_clock::now();
+
     GitLibLock git;
     auto& info = GetRepositoryInformation();
+    const auto& config = GetConfig();
 
-    if (!git.OpenRepo(GetConfig().path))
+    if (!git.OpenRepo(config.path))
     {
         info.is_repo_found = false;
         step_data.error = "Couldn't find repository";
@@ -33,6 +49,13 @@ bool StatusTask::Run()
     }
     info.is_repo_detached = is_repo_detached;
 
+    if (is_repo_detached || info.current_branch != config.default_branch)
+    {
+        info.is_dirty = true;
+        if (stop_on_dirty)
+            return true;
+    }
+
     TASK_RUNNER_CHECK;
 
     if (!git.GetFileModificationStats(should_stop, info.files_added, info.files_modified, info.files_deleted))
@@ -40,8 +63,31 @@ bool StatusTask::Run()
         step_data.error = "Couldn't read modification stats";
         return false;
     }
+
+    TASK_RUNNER_CHECK;
+
+    if (info.files_added || info.files_modified || info.files_deleted)
+        info.is_dirty = true;
     info.no_of_files_complete = true;
 
+    info.status_scan_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - scan_start).count();
+
+    if (stop_on_dirty)
+        return true;
+
+    TASK_RUNNER_CHECK;
+
+    bool has_upstream = false, is_capped = false;
+    if (!git.GetAheadBehind(AheadBehindWalkLimit, has_upstream, info.commits_ahead, info.commits_behind, is_capped))
+    {
+        step_data.error = "Couldn't compare with upstream";
+        return false;
+    }
+    info.has_upstream = has_upstream;
+    info.is_ahead_behind_capped = is_capped;
+    info.ahead_behind_complete = true;
+
     return true;
 }
 
@@ -49,3 +95,19 @@ std::string_view StatusTask::GetCommand()
 {
     return "git status";
 }
+
+ResourceClass StatusTask::GetResourceClass() const
+{
+    return ResourceClass::Disk;
+}
+
+LatencySample StatusTask::GetLatencySample() const
+{
+    const auto& info = GetRepositoryInformation();
+    return { info.status_scan_ms, info.previous_status_scan_ms };
+}
+
+QuietStatusTask::QuietStatusTask(RepoOrchestrator* repo_orchestrator, StepData& step) :
+	StatusTask(repo_orchestrator, step, true)
+{
+}
@@ -3,11 +3,26 @@
 
 struct StatusData;
 
-class StatusTask final : public Task
+class StatusTask : public Task
 {
 public:
 	explicit StatusTask(RepoOrchestrator* repo_orchestrator, StepData& step);
 
 	bool Run() override;
 	std::string_view GetCommand() override;
+	ResourceClass GetResourceClass() const override;
+	LatencySample GetLatencySample() const override;
+
+protected:
+	explicit StatusTask(RepoOrchestrator* repo_orchestrator, StepData& step, bool stop_on_dirty);
+
+private:
+	const bool stop_on_dirty;
+};
+
+// Skips the modification scan once the branch alone marks the repository as dirty
+class QuietStatusTask final : public StatusTask
+{
+public:
+	explicit QuietStatusTask(RepoOrchestrator* repo_orchestrator, StepData& step);
 };
@@ -10,6 +10,21 @@ Task::Task(RepoOrchestrator* parent, StepData& step_data) :
 
 Task::~Task() = default;
 
+ResourceClass Task::GetResourceClass() const
+{
+	return ResourceClass::None;
+}
+
+size_t Task::GetResourceWeight() const
+{
+	return 1;
+}
+
+LatencySample Task::GetLatencySample() const
+{
+	return {};
+}
+
 void Task::Stop()
 {
 	should_stop = true;
@@ -24,3 +39,18 @@ RepositoryInformation& Task::GetRepositoryInformation() const
 {
 	return parent->GetRepositoryInfo();
 }
+
+RunContext& Task::GetRunContext() const
+{
+	return parent->GetRunContext();
+}
+
+void Task::SuspendStep() const
+{
+	parent->SuspendStep();
+}
+
+bool Task::ResumeStep() const
+{
+	return parent->ResumeStep();
+}
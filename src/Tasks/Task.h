@@ -1,12 +1,31 @@
 #pragma once
 #include <atomic>
+#include <cstdint>
 #include <string_view>
 
 struct RepositoryInformation;
 struct RepoConfig;
+struct RunContext;
 struct StepData;
 class RepoOrchestrator;
 
+// What a task mostly waits on, tasks of one class share a resource pool and a concurrency limit
+enum class ResourceClass : uint8_t
+{
+	None,
+	Network,
+	Disk,
+	Cpu,
+};
+
+// Latency of the part of a task that reflects load on its resource, next to what the same part took
+// for this repository before. Negative values mean there is nothing to compare.
+struct LatencySample
+{
+	int64_t measured_ms = -1;
+	int64_t expected_ms = -1;
+};
+
 class Task
 {
 public:
@@ -20,6 +39,11 @@ public:
 
 	virtual bool Run() = 0;
 	virtual std::string_view GetCommand() = 0;
+	virtual ResourceClass GetResourceClass() const;
+	// Share of the resource pool taken while running
+	virtual size_t GetResourceWeight() const;
+	// Read by the concurrency controller once Run returns
+	virtual LatencySample GetLatencySample() const;
 
 	void Stop();
 
@@ -30,6 +54,10 @@ protected:
 
 	virtual const RepoConfig& GetConfig() const;
 	virtual RepositoryInformation& GetRepositoryInformation() const;
+	RunContext& GetRunContext() const;
+	// Frees the pool and adaptive slots while blocked on another repository
+	void SuspendStep() const;
+	bool ResumeStep() const;
 
 private:
 	RepoOrchestrator* parent;
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 
 #include "MultiController.h"
@@ -6,22 +7,39 @@ int ShowUsage()
 {
     std::cout << "Usage: 'mgit <command>'" << std::endl
         << "where:" << std::endl
-        << "\tstatus - displays status for all repositories" << std::endl;
+        << "\tstatus - displays status for all repositories" << std::endl
+        << "\tstatus --quiet - exits with code 1 as soon as any repository is dirty or off its default branch" << std::endl
+        << "\tpull --check - lists repositories with incoming changes using only the remote ref advertisement" << std::endl
+        << "\tprefetch - fetches all remotes into refs/prefetch/ with low priority, for scheduled runs" << std::endl
+        << "options:" << std::endl
+        << "\t--prewarm - reads pack indexes and git indexes into the file cache before status or pull" << std::endl
+        << "\t--narrow / --all-refs - fetches only the default and current branch, or every configured refspec" << std::endl
+        << "\t--no-tags / --tags - skips or follows tags while fetching" << std::endl
+        << "\t--bandwidth=<KiB/s> - limits the combined download rate of all fetches, except those run by git for a partial clone filter" << std::endl
+        << "\t--connections-per-host=<n> - limits concurrent connections to one remote host" << std::endl
+        << "\t--adaptive - adapts the number of concurrent fetches and status scans to observed latency and errors" << std::endl
+        << "\t--jobs=<n> - runs a make jobserver that caps build steps and their make or ninja jobs at n in total" << std::endl
+        << "\t--refresh - fetches every remote even if it was fetched within its ttl_seconds" << std::endl;
     return 0;
 }
 
-int DisplayStatus()
+bool HasFlag(const std::vector<std::string>& args, const std::string_view& flag)
+{
+    return std::ranges::find(args, flag) != args.end();
+}
+
+int DisplayStatus(const std::vector<std::string>& args)
 {
     MultiController ctr;
     std::ostringstream error_stream;
 
-    if(!ctr.LoadConfig(error_stream))
+    if(!ctr.LoadConfig(error_stream, args))
     {
         std::cout << error_stream.rdbuf();
         return 1;
     }
 
-    return ctr.DisplayStatus();
+    return ctr.DisplayStatus(HasFlag(args, "--quiet") || HasFlag(args, "-q"));
 }
 
 int TryRunGitCli(const RepoConfig* repo_config, const std::vector<std::string>& args)
@@ -58,12 +76,12 @@ int TryActivateRepo(const std::string_view& repo_name, const std::vector<std::st
     return 1;
 }
 
-int BuildRepos()
+int BuildRepos(const std::vector<std::string>& args)
 {
     MultiController ctr;
     std::ostringstream error_stream;
 
-    if (!ctr.LoadConfig(error_stream))
+    if (!ctr.LoadConfig(error_stream, args))
     {
         std::cout << error_stream.rdbuf();
         return 1;
@@ -72,18 +90,32 @@ int BuildRepos()
     return ctr.Build();
 }
 
-int PullRepos()
+int PullRepos(const std::vector<std::string>& args)
 {
     MultiController ctr;
     std::ostringstream error_stream;
 
-    if (!ctr.LoadConfig(error_stream))
+    if (!ctr.LoadConfig(error_stream, args))
+    {
+        std::cout << error_stream.rdbuf();
+        return 1;
+    }
+
+    return ctr.Pull(HasFlag(args, "--check"));
+}
+
+int PrefetchRepos(const std::vector<std::string>& args)
+{
+    MultiController ctr;
+    std::ostringstream error_stream;
+
+    if (!ctr.LoadConfig(error_stream, args))
     {
         std::cout << error_stream.rdbuf();
         return 1;
     }
 
-    return ctr.Pull();
+    return ctr.Prefetch();
 }
 
 int HandleCommand(const std::string_view& command, const std::vector<std::string>& args)
@@ -91,11 +123,13 @@ int HandleCommand(const std::string_view& command, const std::vector<std::string
     if(command == "help")
         return ShowUsage();
     if (command == "status")
-        return DisplayStatus();
+        return DisplayStatus(args);
     if (command == "build")
-        return BuildRepos();
+        return BuildRepos(args);
     if (command == "pull")
-        return PullRepos();
+        return PullRepos(args);
+    if (command == "prefetch")
+        return PrefetchRepos(args);
 
     return TryActivateRepo(command, args);
 }